@@ -0,0 +1,80 @@
+// Seqd benchmark - argument-taking sequences
+// Compares the ansi_argd_seq() -> vsnprintf path against the integer
+// encoders that write straight into seqdbuf.
+//
+// Build and run from the repository root:
+//     cc -O2 -o encode bench/encode.c && ./encode
+
+#include "../src/seqd.h"                                                // First, so its feature-test macro reaches the system headers
+#include <time.h>
+
+#define ITERATIONS 2000000
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char* name, double start, unsigned int bytes) {
+    double elapsed = now() - start;
+    printf("%-28s %8.2f ns/op %10u bytes\n", name, elapsed * 1e9 / ITERATIONS, bytes);
+}
+
+int main() {
+    reserve_buffer(ITERATIONS * 24);
+    double start;
+
+    // Cursor moves
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer(SEQD_SETCUR(i % 80 + 1, i % 300 + 1));
+    report("SEQD_SETCUR + buffer", start, seqdbuf_size);
+
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer_setcur(i % 80 + 1, i % 300 + 1);
+    report("buffer_setcur", start, seqdbuf_size);
+
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer(SEQD_CUR_FORWARD(i % 300 + 1));
+    report("SEQD_CUR_FORWARD + buffer", start, seqdbuf_size);
+
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer_csi(i % 300 + 1, 'C');
+    report("buffer_csi", start, seqdbuf_size);
+
+    // Colours
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer(SEQD_FG_256(i & 0xFF));
+    report("SEQD_FG_256 + buffer", start, seqdbuf_size);
+
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer_fg_256(i & 0xFF);
+    report("buffer_fg_256", start, seqdbuf_size);
+
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer(SEQD_FG_RGB(i & 0xFF, (i >> 8) & 0xFF, (i >> 16) & 0xFF));
+    report("SEQD_FG_RGB + buffer", start, seqdbuf_size);
+
+    clear_buffer();
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+        buffer_fg_rgb(i & 0xFF, (i >> 8) & 0xFF, (i >> 16) & 0xFF);
+    report("buffer_fg_rgb", start, seqdbuf_size);
+
+    deinit();
+    return 0;
+}
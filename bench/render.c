@@ -0,0 +1,229 @@
+// Seqd benchmark - whole frames
+// Renders synthetic workloads through the plain buffer()/ansi_argd_seq() path
+// and through the newer engines (screen diffing, SGR state, the log pane), and
+// writes every frame out with display().
+//
+// Build and run from the repository root, output goes to /dev/null unless a
+// path (e.g. a pty from `tty` in another terminal) is given:
+//     cc -O2 -o render bench/render.c && ./render [path]
+// Add -DSEQD_STATS to print the instrumentation counters for each run as well.
+
+#include "../src/seqd.h"                                                // First, so its feature-test macro reaches the system headers
+#include <time.h>
+#include "../src/seqd_screen.h"
+#include "../src/seqd_log.h"
+
+#define WIDTH 200
+#define HEIGHT 60
+#define FRAMES 300
+#define LOG_LINES_PER_FRAME 12
+#define SPARSE_CHANGES_PER_FRAME 10
+
+static unsigned int seed = 2463534242u;
+
+static unsigned int next_random() {                                     // xorshift32, the same numbers every run
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double start;
+static unsigned long long bytes;
+
+static void begin() {
+    reset_stats();
+    bytes = 0;
+    seed = 2463534242u;
+    start = now();
+}
+
+static void frame() {                                                   // Sends the queued frame like an application would
+    bytes += seqdbuf_size;
+    display();
+    clear_buffer();
+}
+
+static void report(const char* name) {
+    double elapsed = now() - start;
+    printf("%-32s %9.1f us/frame %9llu bytes/frame\n", name, elapsed * 1e6 / FRAMES, bytes / FRAMES);
+
+    #ifdef SEQD_STATS
+        seqd_stats s = get_stats();
+        printf("%32s %9llu seq/frame %9llu sgr elided %6llu writes %8.1f us/flush\n", "",
+            s.sequences / FRAMES, s.sgr_elided, s.write_calls, s.frames ? s.flush_ns / 1e3 / s.frames : 0.0);
+    #endif
+}
+
+// Full screen truecolour noise, every cell changes every frame
+
+static void noise_plain() {
+    begin();
+
+    for (int f = 0; f < FRAMES; f++) {
+        for (int row = 1; row <= HEIGHT; row++) {
+            buffer(SEQD_SETCUR(row, 1));
+
+            for (int col = 0; col < WIDTH; col++) {
+                unsigned int c = next_random();
+                buffer(SEQD_BG_RGB(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF));
+                buffer(" ");
+            }
+        }
+
+        buffer(SEQD_RESET);
+        frame();
+    }
+
+    report("noise: SEQD_ + buffer");
+}
+
+static void noise_screen(seqd_screen* s) {
+    begin();
+
+    for (int f = 0; f < FRAMES; f++) {
+        for (int row = 0; row < HEIGHT; row++)
+            for (int col = 0; col < WIDTH; col++) {
+                unsigned int c = next_random();
+                seqd_screen_put(s, row, col, ' ', SEQD_COLOUR_DEFAULT, SEQD_COLOUR_RGB(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF), 0);
+            }
+
+        seqd_screen_render(s);
+        frame();
+    }
+
+    report("noise: seqd_screen");
+}
+
+// A tail view with a burst of new lines every frame
+
+static const char* log_line(int n) {
+    static char line[128];
+    snprintf(line, sizeof(line), "%08d [worker %02u] request handled in %u us, status %u",
+        n, next_random() % 32, next_random() % 5000, 200 + next_random() % 4 * 100);
+    return line;
+}
+
+static void log_plain() {
+    static char lines[HEIGHT][128];                                     // What the pane shows, oldest first
+    int total = 0;
+    begin();
+
+    for (int f = 0; f < FRAMES; f++) {
+        for (int i = 0; i < LOG_LINES_PER_FRAME; i++, total++) {
+            memmove(lines[0], lines[1], sizeof(lines[0]) * (HEIGHT - 1));
+            snprintf(lines[HEIGHT - 1], sizeof(lines[0]), "%s", log_line(total));
+        }
+
+        for (int row = 0; row < HEIGHT; row++) {                        // The whole pane again
+            buffer(SEQD_SETCUR(row + 1, 1));
+            buffer(lines[row]);
+            buffer(SEQD_ERASE_LINE(0));
+        }
+
+        frame();
+    }
+
+    report("log: redraw pane");
+}
+
+static void log_pane(seqd_log* log) {
+    int total = 0;
+    begin();
+
+    for (int f = 0; f < FRAMES; f++) {
+        for (int i = 0; i < LOG_LINES_PER_FRAME; i++, total++)
+            seqd_log_append(log, log_line(total));
+
+        seqd_log_render(log);
+        frame();
+    }
+
+    report("log: seqd_log");
+}
+
+// A mostly static screen with a few cells changing every frame
+
+static void sparse_plain() {
+    static unsigned char colours[HEIGHT][WIDTH];
+    begin();
+
+    for (int f = 0; f < FRAMES; f++) {
+        for (int i = 0; i < SPARSE_CHANGES_PER_FRAME; i++)
+            colours[next_random() % HEIGHT][next_random() % WIDTH] = (unsigned char) next_random();
+
+        for (int row = 0; row < HEIGHT; row++) {                        // Everything, since nothing knows what changed
+            buffer(SEQD_SETCUR(row + 1, 1));
+
+            for (int col = 0; col < WIDTH; col++) {
+                buffer(SEQD_FG_256(colours[row][col]));
+                buffer("#");
+            }
+        }
+
+        buffer(SEQD_RESET);
+        frame();
+    }
+
+    report("sparse: redraw all");
+}
+
+static void sparse_screen(seqd_screen* s) {
+    begin();
+
+    for (int f = 0; f < FRAMES; f++) {
+        for (int i = 0; i < SPARSE_CHANGES_PER_FRAME; i++)
+            seqd_screen_put(s, next_random() % HEIGHT, next_random() % WIDTH, '#', SEQD_COLOUR_256(next_random() & 0xFF), SEQD_COLOUR_DEFAULT, 0);
+
+        seqd_screen_render(s);
+        frame();
+    }
+
+    report("sparse: seqd_screen");
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "/dev/null";
+
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    set_output_fd(fileno(out));
+    printf("%d x %d, %d frames, writing to %s\n", WIDTH, HEIGHT, FRAMES, path);
+
+    seqd_screen screen = { 0 };
+    seqd_screen_resize(&screen, WIDTH, HEIGHT);
+
+    noise_plain();
+    noise_screen(&screen);
+
+    seqd_log log;
+    seqd_log_init(&log, 0, HEIGHT, 0);
+    log.width = WIDTH;
+
+    log_plain();
+    log_pane(&log);
+
+    seqd_screen_invalidate(&screen);
+    seqd_screen_clear(&screen);
+    seqd_screen_render(&screen);                                        // Start from a drawn blank screen, like a running app
+    clear_buffer();
+
+    sparse_plain();
+    sparse_screen(&screen);
+
+    seqd_log_free(&log);
+    seqd_screen_free(&screen);
+    fclose(out);
+    deinit();
+    return 0;
+}
@@ -6,21 +6,43 @@
 #define SEQD_H 
 
 ///////////////////////////////// Dependencies //////////////////////////////// 
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE) && !defined(_GNU_SOURCE) // glibc hides sigaction, clock_gettime, strnlen... under -std=c99/c11
+    #define _DEFAULT_SOURCE                                             // Only works if seqd.h is included before any system header
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
 
 #ifdef _WIN32
     #include <conio.h>
+    #include <io.h>
     #include <windows.h>
 #else 
+    #include <fcntl.h>
+    #include <sys/ioctl.h>
     #include <sys/poll.h>
+    #include <sys/uio.h>
     #include <termios.h>
     #include <unistd.h>
 #endif
 
+#ifndef SEQD_NO_SIMD                                                    // Vector fast path for ASCII runs in the text functions
+    #if defined(__AVX2__)
+        #include <immintrin.h>
+        #define SEQD_SIMD_WIDTH 32
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #include <emmintrin.h>
+        #define SEQD_SIMD_WIDTH 16
+    #endif
+#endif
+
 ///////////////////////////////////// Docs //////////////////////////////////// 
 // Some reference documentation for you. Most of the functions do exactly as //
 // they say on the tin.                                                      //
@@ -36,15 +58,84 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 // Utility functions (intended for library use, not user use)
-static inline char* ctos(char c);                                       // Turns a single char into a null terminated char*, returns NULL on failure
+static inline char* ctos(char c);                                       // Turns a single char into a null terminated char* from seqdctx's frame arena (don't free it, it lasts until display()), returns NULL on failure
 static inline void deinit();                                            // Frees memory related to buffers, and input buffers
 static inline const char* ansi_argd_seq(const char* fmt, ...);          // "Registers" a new SEQD_ command that takes args
+static inline char* encode_uint(char* out, int n);                      // Writes n in decimal (negatives become 0), returns the end - no null terminator
+static inline char* encode_csi(char* out, int n, char final);           // Writes ESC[<n><final>, returns the end
+static inline char* encode_csi2(char* out, int a, int b, char final);  // Writes ESC[<a>;<b><final>, returns the end
+static inline char* encode_setcur(char* out, int row, int col);         // Writes ESC[<row>;<col>H, returns the end
+static inline char* encode_colour(char* out, unsigned int colour, bool fg); // Writes the SGR parameters of a SEQD_COLOUR_ value (no ESC[ or m), returns the end
+static inline int seqd_utf8_encode(unsigned int cp, char* out);        // Writes cp as UTF-8 (up to 4 bytes, no null terminator), returns how many were written
+static inline unsigned int seqd_utf8_decode(const char** s);           // Reads one codepoint and advances *s, invalid bytes become U+FFFD
+
+// Types
+typedef struct seqd_context seqd_context;                               // Output buffer, SGR state and formatting scratch space - defined under the config options
+
+typedef struct seqd_segment {                                           // A piece of output for write_segments(), e.g. static chrome or a context's buffer
+    const char* data;
+    size_t size;
+} seqd_segment;
+
+typedef struct seqd_key {                                               // A decoded key press, see keypress_ex()
+    int code;                                                           // Unicode codepoint of the key, a SEQD_KEYCODE_ for keys without one, 0 for no key
+    unsigned int mods;                                                  // SEQD_MOD_ flags
+} seqd_key;
+
+typedef struct seqd_attr {                                              // Text attributes, see SEQD_COLOUR_ and SEQD_STYLE_ under the ANSI constants
+    unsigned int fg;
+    unsigned int bg;
+    unsigned int style;
+} seqd_attr;
+
+typedef struct seqd_stats {                                             // Counters kept by each context when SEQD_STATS is defined, all 0 otherwise
+    unsigned long long sequences;                                       // Appends to the buffer (buffer, the encoders, SGR flushes...)
+    unsigned long long bytes_queued;
+    unsigned long long sgr_changes;                                     // sgr_flush calls that had to send something
+    unsigned long long sgr_elided;                                      // sgr_flush calls that sent nothing because the attributes hadn't changed
+    unsigned long long frames;                                          // display calls
+    unsigned long long bytes_written;
+    unsigned long long last_frame_bytes;
+    unsigned long long max_frame_bytes;
+    unsigned long long write_calls;                                     // write/writev syscalls made by display
+    unsigned long long flush_ns;                                        // Total time spent in display, writing included
+    unsigned long long last_flush_ns;
+    unsigned long long max_flush_ns;
+} seqd_stats;
+
+#ifndef SEQD_INPUT_BUFFER_SIZE                                          // Listed with the other config options, it is needed this early for seqdin
+#define SEQD_INPUT_BUFFER_SIZE 256
+#endif
 
 // Global variables                                                     // If you do not use seqd for your entire program, you may want to free() these at some point, deinit() achieves this
-char* seqdbuf = NULL;                                                   // For use in display and buffered commands
-unsigned int seqdbuf_size = 0;                                          // For use in display and buffered commands
+/* seqd_context seqdctx */                                              // Default context, used by every function that doesn't take one - defined under the config options
+#define seqdbuf seqdctx.buf                                             // For use in display and buffered commands
+#define seqdbuf_size seqdctx.size                                       // Bytes currently queued in seqdbuf (not counting the null terminator)
+#define seqdbuf_capacity seqdctx.capacity                               // Bytes allocated for seqdbuf, grows geometrically and is kept by clear_buffer()
 char* seqdibuf = NULL;                                                  // For use in input buffers 
+int seqdibuf_size = 0;                                                  // Bytes allocated for seqdibuf, it only grows
+char* seqdline = NULL;                                                  // Line reader buffer, kept between read_line calls
+unsigned int seqdline_start = 0;                                        // First unread byte in seqdline
+unsigned int seqdline_end = 0;                                          // End of the bytes read into seqdline
+unsigned int seqdline_scanned = 0;                                      // Bytes after seqdline_start already searched for '\n'
+bool seqdline_skip = false;                                             // The last line was too long, the rest of it still has to be thrown away
+bool seqdline_truncated = false;                                        // True when read_line's last line was cut at SEQD_LINE_BUFFER_SIZE
+bool seqdline_newline = false;                                          // True when read_line's last line ended with a '\n', false for a last line at EOF without one
 bool seqdraw = false;                                                   // For use in set/unset raw mode and keypress
+char seqdin[SEQD_INPUT_BUFFER_SIZE];                                    // Bytes read from the keyboard that keypress/keypress_ex haven't returned yet
+int seqdin_start = 0;                                                   // For use in keypress and keypress_ex
+int seqdin_end = 0;                                                     // For use in keypress and keypress_ex
+bool seqdin_eof = false;                                                // Set when fill_input finds stdin closed or broken, cleared once input arrives again
+int seqdwidth = 0;                                                      // Cached terminal size, for use in get_terminal_size
+int seqdheight = 0;                                                     // Cached terminal size, for use in get_terminal_size
+volatile sig_atomic_t seqdsize_stale = 1;                               // Set by the SIGWINCH handler, the cache is only trusted while this is 0
+bool seqdsize_watched = false;                                          // True once watch_terminal_size() has installed its handler
+int seqdwinch[2] = { -1, -1 };                                          // Self-pipe the SIGWINCH handler writes to, poll seqdwinch[0] to wake up on resizes
+int seqdlast_width = 0;                                                 // Last size terminal_resized() reported
+int seqdlast_height = 0;                                                // Last size terminal_resized() reported
+int seqdout = 1;                                                        // File descriptor display() and immediate() write to, stdout unless set_output_fd() is used
+unsigned int seqdframe = 0;                                             // SEQD_FRAME_ flags that display() wraps every frame with, see set_frame_mode()
+unsigned long long seqdwrite_calls = 0;                                 // write/writev syscalls made by write_all and write_segments, only counted with SEQD_STATS
 
 #ifdef _WIN32                                                           // These are for use in set/unset_raw_mode, they are platform specific
     DWORD seqdmode;
@@ -55,22 +146,104 @@ bool seqdraw = false;                                                   // For u
 
 // Input
 static inline char keypress();                                          // *Reads a single character from the keyboard
+static inline seqd_key keypress_ex(int timeout);                        // *Reads one whole key (arrows, Home, F1, Alt+x, UTF-8...) waiting up to timeout ms, -1 waits forever - requires raw mode, code 0 on timeout or once seqdin_eof is set
+static inline int decode_key(const char* bytes, int length, bool complete, seqd_key* key); // Decodes the first key in bytes, returns how many bytes it used, 0 if more bytes are needed (never when complete is true)
+static inline bool fill_input(int timeout);                             // *Waits up to timeout ms for keyboard input and reads all of it into seqdin, false if nothing came - seqdin_eof says whether anything ever will
 static inline char* get_input(int max_size);                            // Get line of input from the user (until you hit '\n') and return upto the maximum amount of characters
+static inline bool read_line(const char** line, unsigned int* length);  // *Points line at the next line of stdin (no '\n', null terminated) valid until the next call, false at EOF or on error - seqdline_newline says whether it ended in one
+void clear_seqd_input();                                                // Throws away the rest of a line that was too long for the last read_line/get_input, seqdline_skip stays true if it gave up after SEQD_MAX_GET_LINE_MAXIMUM_ITERATION reads (read_line carries on where it stopped)
 
 
 // Output
 static inline void display();                                           // Display everything stored in the buffer
 static inline char* buffer(const char* sequence);                       // Buffered commands until display is called - sequence must be null terminated
+static inline char* buffer_n(const char* sequence, unsigned int length);// Same as buffer, but with a known length - sequence doesn't need to be null terminated
+static inline bool reserve_buffer(unsigned int size);                   // Makes sure seqdbuf can hold size bytes without reallocating, returns false on failure
+static inline void clear_buffer();                                      // Empties the buffer but keeps its allocation for the next frame
+static inline char* buffer_csi(int n, char final);                      // Buffers ESC[<n><final> (e.g. 'A' for SEQD_CUR_UP) without going through vsnprintf
+static inline char* buffer_setcur(int row, int col);                    // Buffers SEQD_SETCUR(row, col) without going through vsnprintf
+static inline char* buffer_scroll_region(int top, int bottom);          // Buffers SEQD_SCROLL_REGION(top, bottom) without going through vsnprintf
+static inline char* buffer_fg_256(int col);                             // Buffers SEQD_FG_256(col) without going through vsnprintf
+static inline char* buffer_bg_256(int col);                             // Buffers SEQD_BG_256(col) without going through vsnprintf
+static inline char* buffer_fg_rgb(int r, int g, int b);                 // Buffers SEQD_FG_RGB(r, g, b) without going through vsnprintf
+static inline char* buffer_bg_rgb(int r, int g, int b);                 // Buffers SEQD_BG_RGB(r, g, b) without going through vsnprintf
 static inline void null_terminated_buffers(const char* first, ...);     // Variable arguments that are NULL terminated
 /* MACRO queue(x)      null_terminated_buffers(##x, NULL) */            // Macro to call null_termianted_buffers with trailing NULL
+/* MACRO queue_const(literal) */                                        // Buffers a string literal (e.g. a SEQD_..._C sequence) with its length worked out at compile time
 
 static inline void immediate(const char* sequence);                     // Immediate flushing
 static inline void null_terminated_immediates(const char* first, ...);  // Variable arguments that are NULL terminated
 /* MACRO execute(...) */                                                // Macro to call null_termianted_buffers with trailing NULL
 
+static inline void set_output_fd(int fd);                               // Where display() and immediate() write, stdout (1) by default
+static inline void set_frame_mode(unsigned int flags);                  // SEQD_FRAME_ flags for display(), 0 (the default) sends the buffer as it is
+static inline bool write_all(int fd, const char* data, size_t size);    // *Writes everything straight to fd, retrying partial writes, EINTR and EAGAIN - false on error
+static inline bool write_segments(int fd, const seqd_segment* segments, int count); // *Writes a list of segments with writev, one syscall per SEQD_WRITEV_BATCH segments when the fd keeps up
+
+// Instrumentation                                                      // Only counts anything when SEQD_STATS is defined before including seqd.h
+static inline seqd_stats get_stats();                                   // seqdctx's counters, other contexts keep theirs in ctx->stats
+static inline void reset_stats();                                       // Zeroes seqdctx's counters
+static inline unsigned long long seqd_clock_ns();                       // *Nanoseconds on a monotonic clock
+
+
+// Attribute state                                                      // Tracks the SGR state of the terminal so unchanged colours and styles aren't resent
+static inline void sgr_fg(unsigned int colour);                         // Sets the pending foreground to a SEQD_COLOUR_ value
+static inline void sgr_bg(unsigned int colour);                         // Sets the pending background to a SEQD_COLOUR_ value
+static inline void sgr_style(unsigned int style);                       // Replaces the pending style with SEQD_STYLE_ flags
+static inline void sgr_style_on(unsigned int style);                    // Adds SEQD_STYLE_ flags to the pending style
+static inline void sgr_style_off(unsigned int style);                   // Removes SEQD_STYLE_ flags from the pending style
+static inline void sgr_set(seqd_attr attr);                             // Replaces every pending attribute
+static inline void sgr_reset();                                         // Pending attributes go back to the terminal defaults
+static inline void sgr_flush();                                         // Queues one combined ESC[...m for whatever changed, nothing if nothing did
+static inline void sgr_text(const char* text);                          // sgr_flush() then buffer(text)
+static inline void sgr_invalidate();                                    // Call after queueing SGR sequences by hand, the next flush sends everything
+static inline int sgr_transition(char* out, seqd_attr from, seqd_attr to); // Writes the shortest ESC[...m from -> to into out (64 bytes), returns its length - style bits beyond the SEQD_STYLE_ set in from force a reset
+
+// Text measurement (columns on screen, not bytes)
+static inline int char_width(unsigned int cp);                          // Columns a codepoint takes - 2 for East Asian wide, 0 for combining marks and control characters, otherwise 1
+static inline int text_width(const char* utf8, size_t size);            // Columns the first size bytes of utf8 take
+static inline size_t text_fit(const char* utf8, size_t size, int columns, int* used); // Bytes of the longest prefix that fits in columns, used (can be NULL) gets its width - never splits a character
+static inline char* buffer_text(const char* utf8, size_t size, int columns); // Queues the prefix that fits then pads with spaces, so it takes exactly columns
+
+// Contexts                                                             // Each thread building output should use its own context, the functions above all use seqdctx
+static inline void seqd_context_free(seqd_context* ctx);                // Frees the context's buffer and arena, the context can be reused afterwards
+static inline void seqd_display(seqd_context* ctx);                     // display() for a context
+static inline bool seqd_reserve(seqd_context* ctx, unsigned int size);  // reserve_buffer() for a context
+static inline void seqd_clear(seqd_context* ctx);                       // clear_buffer() for a context
+static inline char* seqd_buffer(seqd_context* ctx, const char* sequence);                       // buffer() for a context
+static inline char* seqd_buffer_n(seqd_context* ctx, const char* sequence, unsigned int length);// buffer_n() for a context
+static inline char* seqd_append(seqd_context* dst, const seqd_context* src);                    // Queues everything in src onto dst, for handing worker output to one writer
+static inline char* seqd_csi(seqd_context* ctx, int n, char final);     // buffer_csi() for a context
+static inline char* seqd_setcur(seqd_context* ctx, int row, int col);   // buffer_setcur() for a context
+static inline char* seqd_scroll_region(seqd_context* ctx, int top, int bottom); // buffer_scroll_region() for a context
+static inline char* seqd_fg_256(seqd_context* ctx, int col);            // buffer_fg_256() for a context
+static inline char* seqd_bg_256(seqd_context* ctx, int col);            // buffer_bg_256() for a context
+static inline char* seqd_fg_rgb(seqd_context* ctx, int r, int g, int b);// buffer_fg_rgb() for a context
+static inline char* seqd_bg_rgb(seqd_context* ctx, int r, int g, int b);// buffer_bg_rgb() for a context
+static inline const char* seqd_argd_seq(seqd_context* ctx, const char* fmt, ...); // ansi_argd_seq() using the context's own scratch slots
+static inline void* seqd_alloc(seqd_context* ctx, unsigned int size);   // Memory from the context's frame arena (8 byte aligned), valid until the context is displayed - never free it, NULL on failure
+static inline void seqd_arena_reset(seqd_context* ctx);                 // Hands the whole arena back in one go, seqd_display does this - call it yourself if the context is never displayed
+static inline char* seqd_ctos(seqd_context* ctx, char c);               // ctos() for a context
+static inline const char* seqd_format(seqd_context* ctx, const char* fmt, ...); // ansi_argd_seq() into the arena, so there is no length limit or slot reuse, NULL on failure
+static inline void seqd_reset_stats(seqd_context* ctx);                 // reset_stats() for a context
+static inline void seqd_sgr_fg(seqd_context* ctx, unsigned int colour); // sgr_fg() for a context
+static inline void seqd_sgr_bg(seqd_context* ctx, unsigned int colour); // sgr_bg() for a context
+static inline void seqd_sgr_style(seqd_context* ctx, unsigned int style);       // sgr_style() for a context
+static inline void seqd_sgr_style_on(seqd_context* ctx, unsigned int style);    // sgr_style_on() for a context
+static inline void seqd_sgr_style_off(seqd_context* ctx, unsigned int style);   // sgr_style_off() for a context
+static inline void seqd_sgr_set(seqd_context* ctx, seqd_attr attr);     // sgr_set() for a context
+static inline void seqd_sgr_reset(seqd_context* ctx);                   // sgr_reset() for a context
+static inline void seqd_sgr_flush(seqd_context* ctx);                   // sgr_flush() for a context
+static inline void seqd_sgr_text(seqd_context* ctx, const char* text);  // sgr_text() for a context
+static inline char* seqd_text(seqd_context* ctx, const char* utf8, size_t size, int columns); // buffer_text() for a context
+static inline void seqd_sgr_invalidate(seqd_context* ctx);              // sgr_invalidate() for a context
 
 // Cursor manipulation
-static inline void get_terminal_size(int* width, int* height);          // Returns the width of the terminal in characters, requires raw mode
+static inline void get_terminal_size(int* width, int* height);          // *Terminal size in characters - cached, asked for with ioctl, and only probed with SEQD_CURPOS (raw mode) as a last resort
+static inline bool terminal_resized(int* width, int* height);           // Returns true (and the new size) once for each real change in size, false otherwise
+static inline bool watch_terminal_size();                               // *Installs the SIGWINCH handler that keeps the cache right, get_terminal_size calls this - false if another handler is installed
+static inline bool query_terminal_size(int* width, int* height);        // *Asks the OS for the size (ioctl TIOCGWINSZ), uncached, false when it can't tell
+static inline bool probe_terminal_size(int* width, int* height);        // *The SEQD_CURPOS probe on its own, reads the reply without blocking or eating keystrokes - requires raw mode
     
 // Setting terminal "raw mode"
 static inline void set_raw_mode();                                      // *Turns on terminal raw mode - in this mode you can perform non-blocking reads on the keyboard
@@ -80,13 +253,25 @@ static inline void unset_raw_mode();                                    // *Turn
 // Some options that you can #define to alter the behaviour of seqd.         //
 ///////////////////////////////////////////////////////////////////////////////
 #ifndef SEQD_MAX_GET_LINE_MAXIMUM_ITERATION 
-#define SEQD_MAX_GET_LINE_MAXIMUM_ITERATION 1024                        // Maximum iteration count for get_line_until
+#define SEQD_MAX_GET_LINE_MAXIMUM_ITERATION 1024                        // Maximum reads one clear_seqd_input call spends throwing away the rest of a line that was too long
+#endif
+
+#ifndef SEQD_LINE_BUFFER_SIZE
+#define SEQD_LINE_BUFFER_SIZE 65536                                     // Longest line read_line returns whole, longer ones are cut and seqdline_truncated is set
 #endif
 
 #ifndef SEQD_MAX_BUFFER_SIZE
 #define SEQD_MAX_BUFFER_SIZE 1024                                       // Decides maximum input size for certain functions
 #endif
 
+#ifndef SEQD_BUFFER_INITIAL_CAPACITY
+#define SEQD_BUFFER_INITIAL_CAPACITY 4096                               // First allocation size of seqdbuf, it doubles whenever it runs out of space
+#endif
+
+#ifndef SEQD_ARENA_INITIAL_CAPACITY
+#define SEQD_ARENA_INITIAL_CAPACITY 4096                                // First block of a context's frame arena, a frame that outgrows it gets one block big enough from then on
+#endif
+
 #ifndef SEQD_STATIC_BUFFER_SIZE                                         // Static buffer used for ansi_argd_seq (any function starting with SEQD_ that takes a value)
 #define SEQD_STATIC_BUFFER_SIZE 32
 #endif
@@ -95,10 +280,67 @@ static inline void unset_raw_mode();                                    // *Turn
 #define SEQD_STATIC_BUFFER_COUNT 8
 #endif
 
+/* SEQD_STATS */                                                        // Define it to count sequences, bytes, elided SGR changes, write syscalls and display time, see get_stats()
+
+#ifndef SEQD_WRITEV_BATCH
+#define SEQD_WRITEV_BATCH 64                                            // Most segments handed to a single writev() call
+#endif
+
 #ifndef SEQD_KEYBOARD_TIMEOUT
 #define SEQD_KEYBOARD_TIMEOUT 100                                       // Maxmimum milliseconds that nonblocking keypress() polls for
 #endif
 
+#ifndef SEQD_PROBE_TIMEOUT
+#define SEQD_PROBE_TIMEOUT 200                                          // Milliseconds probe_terminal_size waits for the terminal to answer
+#endif
+
+#ifndef SEQD_ESC_TIMEOUT
+#define SEQD_ESC_TIMEOUT 25                                             // Milliseconds keypress_ex waits for the rest of a sequence before treating ESC as the Escape key
+#endif
+
+/* SEQD_INPUT_BUFFER_SIZE 256 */                                        // Bytes keypress_ex reads from the keyboard in one go, defined above the global variables
+
+////////////////////////////////// Contexts ///////////////////////////////////
+// A context owns everything needed to build output, so two threads that    //
+// each use their own context never share state. A zeroed context is ready  //
+// to use. Its SGR state starts out unknown, so the first sgr flush in a     //
+// context sends every attribute. That way segments built by different       //
+// contexts can be appended in any order.                                    //
+//                                                                           //
+// Every context also owns a frame arena for short lived strings such as     //
+// ctos() results. Allocating from it is a pointer bump, and seqd_display    //
+// frees everything in it at once, so a steady frame loop never calls malloc //
+// or free.                                                                  //
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct seqd_arena_block {
+    struct seqd_arena_block* prev;                                      // Block that filled up before this one, NULL for the first
+    unsigned int capacity;
+    unsigned int used;
+    char* data;                                                         // Right after the header, 8 byte aligned
+} seqd_arena_block;
+
+struct seqd_context {
+    char* buf;                                                          // Queued output, null terminated once allocated
+    unsigned int size;                                                  // Bytes queued (not counting the null terminator)
+    unsigned int capacity;                                              // Bytes allocated, grows geometrically and is kept by seqd_clear()
+    seqd_attr pen;                                                      // Attributes the terminal will be drawing with once buf is written
+    seqd_attr pending;                                                  // Attributes the next seqd_sgr_flush() moves to
+    bool pen_known;                                                     // False until the first flush, or after seqd_sgr_invalidate()
+    char scratch[SEQD_STATIC_BUFFER_COUNT][SEQD_STATIC_BUFFER_SIZE];    // Rotating slots for seqd_argd_seq()
+    int scratch_index;
+    seqd_arena_block* arena;                                            // Newest block of the frame arena, NULL until the first seqd_alloc()
+    seqd_stats stats;                                                   // Always there, so the layout doesn't depend on SEQD_STATS
+};
+
+#ifdef SEQD_STATS                                                       // Instrumentation compiles away unless asked for
+    #define SEQD_STAT(statement) do { statement; } while (0)
+#else
+    #define SEQD_STAT(statement) do { } while (0)
+#endif
+
+seqd_context seqdctx = { 0 };
+
 //////////////////////////////// ANSI constants /////////////////////////////// 
 
 #define SEQD_ESC                    "\033["
@@ -110,6 +352,15 @@ static inline void unset_raw_mode();                                    // *Turn
 #define SEQD_HIDECUR                SEQD_ESC "?25l" 
 #define SEQD_SHOWCUR                SEQD_ESC "?25h" 
 
+// Synchronized output (DEC mode 2026) - terminals that support it hold back
+// painting until the end marker, terminals that don't just ignore both
+#define SEQD_SYNC_BEGIN             SEQD_ESC "?2026h"
+#define SEQD_SYNC_END               SEQD_ESC "?2026l"
+
+// Frame mode flags (for set_frame_mode)
+#define SEQD_FRAME_SYNC             (1u << 0)                           // Wraps each display() in SEQD_SYNC_BEGIN/SEQD_SYNC_END
+#define SEQD_FRAME_HIDE_CURSOR      (1u << 1)                           // Hides the cursor while the frame is drawn, and shows it again after
+
 static inline const char* SEQD_SETCUR(int row, int col ) {return ansi_argd_seq("\033[%d;%dH", row, col);}
 static inline const char* SEQD_CUR_UP(int n)             {return ansi_argd_seq("\033[%dA",    n       );}
 static inline const char* SEQD_CUR_DOWN(int n)           {return ansi_argd_seq("\033[%dB",    n       );}
@@ -125,6 +376,10 @@ static inline const char* SEQD_CUR_HORIZONTAL(int n)     {return ansi_argd_seq("
 static inline const char* SEQD_SCROLL_UP(int n)          {return ansi_argd_seq("\033[%dS",    n       );}
 static inline const char* SEQD_SCROLL_DOWN(int n)        {return ansi_argd_seq("\033[%dT",    n       );}
 
+// Scroll region (DECSTBM) - SEQD_SCROLL_UP/DOWN and line feeds only move rows top to bottom (1 based), both move the cursor to 1;1
+#define SEQD_SCROLL_REGION_RESET    SEQD_ESC "r"
+static inline const char* SEQD_SCROLL_REGION(int top, int bottom) {return ansi_argd_seq("\033[%d;%dr", top, bottom);}
+
 static inline const char* SEQD_ERASE_DISPLAY(int n)      {return ansi_argd_seq("\033[%dJ",    n       );}
 static inline const char* SEQD_ERASE_LINE(int n)         {return ansi_argd_seq("\033[%dK",    n       );}
 
@@ -158,6 +413,42 @@ static inline const char* SEQD_BG_256(int col)              { return ansi_argd_s
 
 static inline const char* SEQD_FG_RGB(int r, int g, int b)  { return ansi_argd_seq("\033[38;2;%d;%d;%dm", r, g, b); }
 static inline const char* SEQD_BG_RGB(int r, int g, int b)  { return ansi_argd_seq("\033[48;2;%d;%d;%dm", r, g, b); }
+
+// Constant versions of the functions above
+// These only take integer literals (or macros that expand to one), and are
+// built into a string literal by the preprocessor. They can be joined with
+// other literals and cost no formatting at runtime, which suits fixed chrome
+// like borders, headers and palettes:
+//     queue_const(SEQD_SETCUR_C(1, 1) SEQD_FG_RGB_C(255, 128, 0) "Title");
+#define SEQD_STR_(x)                #x
+#define SEQD_STR(x)                 SEQD_STR_(x)
+
+#define SEQD_SETCUR_C(row, col)     SEQD_ESC SEQD_STR(row) ";" SEQD_STR(col) "H"
+#define SEQD_CUR_UP_C(n)            SEQD_ESC SEQD_STR(n) "A"
+#define SEQD_CUR_DOWN_C(n)          SEQD_ESC SEQD_STR(n) "B"
+#define SEQD_CUR_FORWARD_C(n)       SEQD_ESC SEQD_STR(n) "C"
+#define SEQD_CUR_BACKWARD_C(n)      SEQD_ESC SEQD_STR(n) "D"
+#define SEQD_CUR_NEXT_LINE_C(n)     SEQD_ESC SEQD_STR(n) "E"
+#define SEQD_CUR_PREV_LINE_C(n)     SEQD_ESC SEQD_STR(n) "F"
+#define SEQD_CUR_HORIZONTAL_C(n)    SEQD_ESC SEQD_STR(n) "G"
+
+#define SEQD_SCROLL_UP_C(n)         SEQD_ESC SEQD_STR(n) "S"
+#define SEQD_SCROLL_DOWN_C(n)       SEQD_ESC SEQD_STR(n) "T"
+#define SEQD_SCROLL_REGION_C(t, b)  SEQD_ESC SEQD_STR(t) ";" SEQD_STR(b) "r"
+#define SEQD_ERASE_DISPLAY_C(n)     SEQD_ESC SEQD_STR(n) "J"
+#define SEQD_ERASE_LINE_C(n)        SEQD_ESC SEQD_STR(n) "K"
+
+#define SEQD_FG_7_C(col)            SEQD_ESC "3" SEQD_STR(col) "m"
+#define SEQD_BG_7_C(col)            SEQD_ESC "4" SEQD_STR(col) "m"
+#define SEQD_FG_B7_C(col)           SEQD_ESC "9" SEQD_STR(col) "m"
+#define SEQD_BG_B7_C(col)           SEQD_ESC "10" SEQD_STR(col) "m"
+
+#define SEQD_FG_256_C(col)          SEQD_ESC "38;5;" SEQD_STR(col) "m"
+#define SEQD_BG_256_C(col)          SEQD_ESC "48;5;" SEQD_STR(col) "m"
+
+#define SEQD_FG_RGB_C(r, g, b)      SEQD_ESC "38;2;" SEQD_STR(r) ";" SEQD_STR(g) ";" SEQD_STR(b) "m"
+#define SEQD_BG_RGB_C(r, g, b)      SEQD_ESC "48;2;" SEQD_STR(r) ";" SEQD_STR(g) ";" SEQD_STR(b) "m"
+
 // Colour constants
 #define SEQD_FG_BLACK               SEQD_ESC "30m"
 #define SEQD_FG_RED                 SEQD_ESC "31m"
@@ -195,13 +486,28 @@ static inline const char* SEQD_BG_RGB(int r, int g, int b)  { return ansi_argd_s
 #define SEQD_BG_BRIGHT_CYAN         SEQD_ESC "106m"
 #define SEQD_BG_BRIGHT_WHITE        SEQD_ESC "107m"
 
+// Colour values (for seqd_attr and the sgr_ functions)
+#define SEQD_COLOUR_DEFAULT         0u                                  // Terminal default colour
+#define SEQD_COLOUR_256(n)          (0x01000000u | ((unsigned int) (n) & 0xFF))
+#define SEQD_COLOUR_RGB(r, g, b)    (0x02000000u | (((unsigned int) (r) & 0xFF) << 16) | (((unsigned int) (g) & 0xFF) << 8) | ((unsigned int) (b) & 0xFF))
+
+// Style flags (for seqd_attr and the sgr_ functions)
+#define SEQD_STYLE_BOLD             (1u << 0)
+#define SEQD_STYLE_FAINT            (1u << 1)
+#define SEQD_STYLE_ITALIC           (1u << 2)
+#define SEQD_STYLE_UNDERLINE        (1u << 3)
+#define SEQD_STYLE_BLINK            (1u << 4)
+#define SEQD_STYLE_REVERSE          (1u << 5)
+#define SEQD_STYLE_CONCEAL          (1u << 6)
+#define SEQD_STYLE_CROSSED_OUT      (1u << 7)
+
 ///////////////////////////// Useful key constants //////////////////////////// 
 
 #define SEQD_KEY_CTRL_PLUS_(k)      ((k) & 0x1F)        // Macro function for "Ctrl + key` - in raw mode this shows up as "key-64" (only for a-z)   // TODO: ansi_argd_seq
 
 #define SEQD_KEY_SHIFT_PLUS_(k)     ((k) ^ 0x20)        // Macro function for "Shift + key` - in raw mode this shows up as uppercase, doesn't work for some keys // TODO: ansi_argd_seq
 
-#define SEQD_KEY_ALT_PLUS_(k)       SEQD_ESC (k)        // TODO: implement keypress_ex that can detect this
+#define SEQD_KEY_ALT_PLUS_(k)       SEQD_ESC (k)        // keypress_ex returns this as k with SEQD_MOD_ALT
 
 #define SEQD_KEY_ESC                '\x1B'
 #define SEQD_KEY_BACKSPACE          '\x7F'
@@ -209,324 +515,1697 @@ static inline const char* SEQD_BG_RGB(int r, int g, int b)  { return ansi_argd_s
 #define SEQD_KEY_ENTER              '\n'
 #define SEQD_KEY_RETURN             '\n'
 
-#define SEQD_KEY_UP                 SEQD_ESC "A"        // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_DOWN               SEQD_ESC "B"        // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_RIGHT              SEQD_ESC "C"        // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_LEFT               SEQD_ESC "D"        // TODO: implement keypress_ex that can detect this
-
-#define SEQD_KEY_INSERT             SEQD_ESC "2~"       // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_DELETE             SEQD_ESC "3~"       // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_HOME               SEQD_ESC "H"        // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_END                SEQD_ESC "F"        // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_PAGE_UP            SEQD_ESC "5~"       // TODO: implement keypress_ex that can detect this
-#define SEQD_KEY_PAGE_DOWN          SEQD_ESC "6~"       // TODO: implement keypress_ex that can detect this
+#define SEQD_KEY_UP                 SEQD_ESC "A"        // keypress_ex returns SEQD_KEYCODE_UP
+#define SEQD_KEY_DOWN               SEQD_ESC "B"        // keypress_ex returns SEQD_KEYCODE_DOWN
+#define SEQD_KEY_RIGHT              SEQD_ESC "C"        // keypress_ex returns SEQD_KEYCODE_RIGHT
+#define SEQD_KEY_LEFT               SEQD_ESC "D"        // keypress_ex returns SEQD_KEYCODE_LEFT
+
+#define SEQD_KEY_INSERT             SEQD_ESC "2~"       // keypress_ex returns SEQD_KEYCODE_INSERT
+#define SEQD_KEY_DELETE             SEQD_ESC "3~"       // keypress_ex returns SEQD_KEYCODE_DELETE
+#define SEQD_KEY_HOME               SEQD_ESC "H"        // keypress_ex returns SEQD_KEYCODE_HOME
+#define SEQD_KEY_END                SEQD_ESC "F"        // keypress_ex returns SEQD_KEYCODE_END
+#define SEQD_KEY_PAGE_UP            SEQD_ESC "5~"       // keypress_ex returns SEQD_KEYCODE_PAGE_UP
+#define SEQD_KEY_PAGE_DOWN          SEQD_ESC "6~"       // keypress_ex returns SEQD_KEYCODE_PAGE_DOWN
+
+// Key codes (seqd_key.code) for keys that have no character, above the Unicode range
+#define SEQD_KEYCODE_UP             0x110001
+#define SEQD_KEYCODE_DOWN           0x110002
+#define SEQD_KEYCODE_RIGHT          0x110003
+#define SEQD_KEYCODE_LEFT           0x110004
+#define SEQD_KEYCODE_INSERT         0x110005
+#define SEQD_KEYCODE_DELETE         0x110006
+#define SEQD_KEYCODE_HOME           0x110007
+#define SEQD_KEYCODE_END            0x110008
+#define SEQD_KEYCODE_PAGE_UP        0x110009
+#define SEQD_KEYCODE_PAGE_DOWN      0x11000A
+#define SEQD_KEYCODE_F(n)           (0x110010 + (n))    // F1 to F12
+#define SEQD_KEYCODE_UNKNOWN        0x1100FF            // A complete escape sequence seqd doesn't know, it is consumed so its bytes don't show up as keys
+
+// Modifier flags (seqd_key.mods), the values match the xterm modifier parameter minus one
+#define SEQD_MOD_SHIFT              (1u << 0)
+#define SEQD_MOD_ALT                (1u << 1)
+#define SEQD_MOD_CTRL               (1u << 2)
 
 ////////////////////////////// Utility functions //////////////////////////////
 static inline char* ctos(char c) {      // char to string (null terminated char*)
-    char* s = (char*) malloc(2);
-
-    if (s == NULL)
-        return NULL;
-    
-    s[0] = c;
-    s[1] = '\0';
-    return s;
+    return seqd_ctos(&seqdctx, c);
 }
 
 static inline void deinit() {
-    seqdbuf_size = 0;
-    if (seqdbuf != NULL) {
-        free(seqdbuf);
-        seqdbuf = NULL;
-    }
+    seqd_context_free(&seqdctx);
     
     if (seqdibuf != NULL) {
         free(seqdibuf);
         seqdibuf = NULL; 
     }
+
+    free(seqdline);
+    seqdline = NULL;
+    seqdibuf_size = 0;
+    seqdline_start = seqdline_end = seqdline_scanned = 0;
+    seqdline_skip = false;
 }
 
-static inline const char* ansi_argd_seq(const char* fmt, ...) {   // Takes a format and argument list to match to an escape sequence
+static inline const char* seqd_vargd_seq(seqd_context* ctx, const char* fmt, va_list args) {
     // Get target buffer 
-    static char bufs[SEQD_STATIC_BUFFER_COUNT][SEQD_STATIC_BUFFER_SIZE]; // Avoids a bug where execute("...", "...") will rewrite the same buffer 
-    static int index = 0;
-    
-    char* buf = bufs[index];
-    index = (index + 1) % SEQD_STATIC_BUFFER_COUNT;
+    char* buf = ctx->scratch[ctx->scratch_index];                      // Rotating slots avoid a bug where execute("...", "...") will rewrite the same buffer 
+    ctx->scratch_index = (ctx->scratch_index + 1) % SEQD_STATIC_BUFFER_COUNT;
+
+    vsnprintf(buf, SEQD_STATIC_BUFFER_SIZE, fmt, args);
+    return buf;
+}
 
-    // Get args and write to the buffer
+static inline const char* seqd_argd_seq(seqd_context* ctx, const char* fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buf, 32, fmt, args);   
+    const char* buf = seqd_vargd_seq(ctx, fmt, args);
+    va_end(args);
+
+    return buf;
+}
+
+static inline const char* ansi_argd_seq(const char* fmt, ...) {   // Takes a format and argument list to match to an escape sequence
+    va_list args;
+    va_start(args, fmt);
+    const char* buf = seqd_vargd_seq(&seqdctx, fmt, args);
     va_end(args);
     
     return buf;
 }
 
-////////////////////////// Cross platform functions /////////////////////////// 
+// Frame arena (see the contexts section)
 
+static inline void* seqd_alloc(seqd_context* ctx, unsigned int size) {
+    size = (size + 7u) & ~7u;                                           // Keeps the next allocation aligned too
+    seqd_arena_block* block = ctx->arena;
 
+    if (block == NULL || block->capacity - block->used < size) {        // Full, chain a bigger block - the old one stays valid until the reset
+        unsigned int capacity = block ? block->capacity * 2 : SEQD_ARENA_INITIAL_CAPACITY;
+        while (capacity < size)
+            capacity *= 2;
 
-// Buffering sequences to be executed later (when display() is called)
+        unsigned int header = (sizeof(seqd_arena_block) + 7u) & ~7u;
+        seqd_arena_block* grown = (seqd_arena_block*) malloc(header + capacity);
+        if (grown == NULL)
+            return NULL;
 
-static inline void display() {
-    if (seqdbuf == NULL)
-        return;
+        grown->prev = block;
+        grown->capacity = capacity;
+        grown->used = 0;
+        grown->data = (char*) grown + header;
+        ctx->arena = block = grown;
+    }
 
-    fputs(seqdbuf, stdout);
-    fflush(stdout);
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
 }
 
-static inline char* buffer(const char* sequence) {
-    if (seqdbuf == NULL) {                  // If seqdbuf hasn't been allocated, allocate it.
-        seqdbuf = (char*) malloc(1);
+static inline void seqd_arena_reset(seqd_context* ctx) {
+    seqd_arena_block* block = ctx->arena;
+    if (block == NULL)
+        return;
 
-        if (seqdbuf == NULL) {
-            seqdbuf_size = 0;
-            return NULL;
-        }
+    block->used = 0;                                                    // The usual case, one block and nothing else to do
+    if (block->prev == NULL)
+        return;
 
-        seqdbuf_size = 1;
-        seqdbuf[0] = '\0';
+    // This frame needed more than one block, swap them for a single block that fits it all
+    unsigned int capacity = 0;
+    while (block != NULL) {
+        seqd_arena_block* prev = block->prev;
+        capacity += block->capacity;
+        free(block);
+        block = prev;
     }
 
+    ctx->arena = NULL;
+    if (seqd_alloc(ctx, capacity) != NULL)
+        ctx->arena->used = 0;
+}
 
-    // Calculate sizes
-    int sequence_size = strnlen(sequence, SEQD_MAX_BUFFER_SIZE);
-    
-    // Buffer reallocation
-    seqdbuf = realloc(seqdbuf, seqdbuf_size + sequence_size);
+static inline char* seqd_ctos(seqd_context* ctx, char c) {
+    char* s = (char*) seqd_alloc(ctx, 2);
 
-    if (seqdbuf == NULL) {
-        seqdbuf_size = 0;
+    if (s == NULL)
         return NULL;
-    }
 
-    seqdbuf_size += sequence_size;          // If allocation succeeds then add it to the seqdbuf_size
-
-    strncat(seqdbuf, sequence, seqdbuf_size);
-    return seqdbuf;
+    s[0] = c;
+    s[1] = '\0';
+    return s;
 }
 
-static inline void null_terminated_buffers(const char* first, ...) { 
+static inline const char* seqd_format(seqd_context* ctx, const char* fmt, ...) {
     va_list args;
-    va_start(args, first);
+    seqd_arena_block* block = ctx->arena;
 
-    const char* sequence = first;
+    // Formatted straight into the free end of the arena, which is where seqd_alloc hands out the bytes if it fits
+    char* free_space = block ? block->data + block->used : NULL;
+    unsigned int free_size = block ? block->capacity - block->used : 0;
 
-    do {
-        buffer(sequence);
-        sequence = va_arg(args, const char*);
-    } while (sequence != NULL);
-}
+    va_start(args, fmt);
+    int length = vsnprintf(free_space, free_size, fmt, args);
+    va_end(args);
 
-#define queue(...) null_terminated_buffers(__VA_ARGS__, NULL)          // Asserts NULL termination
+    if (length < 0)
+        return NULL;
 
+    if ((unsigned int) length < free_size)
+        return (const char*) seqd_alloc(ctx, (unsigned int) length + 1);
 
+    // Too long for this block, take a big enough piece and format again
 
-// Immediately displaying sequences
+    char* buf = (char*) seqd_alloc(ctx, (unsigned int) length + 1);
+    if (buf == NULL)
+        return NULL;
 
-static inline void immediate(const char* sequence) {                    // Immediate flushing
-    fputs(sequence, stdout);
-    fflush(stdout);
-} 
+    va_start(args, fmt);
+    vsnprintf(buf, (size_t) length + 1, fmt, args);
+    va_end(args);
 
+    return buf;
+}
 
-static inline void null_terminated_immediates(const char* first, ...) { 
-    va_list args;
-    va_start(args, first);
+// Integer encoders (used instead of vsnprintf where the sequence shape is fixed)
 
-    const char* sequence = first;
+static inline char* encode_uint(char* out, int n) {
+    static const char pairs[201] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
 
-    do {
-        immediate(sequence);
-        sequence = va_arg(args, const char*);
-    } while (sequence != NULL);
+    unsigned int v = n < 0 ? 0 : (unsigned int) n;
+    char tmp[10];
+    char* p = tmp + sizeof(tmp);
+
+    while (v >= 100) {                                                  // Two digits per division, written back to front
+        unsigned int i = (v % 100) * 2;
+        v /= 100;
+        *--p = pairs[i + 1];
+        *--p = pairs[i];
+    }
+
+    if (v >= 10) {
+        *--p = pairs[v * 2 + 1];
+        *--p = pairs[v * 2];
+    } else {
+        *--p = (char) ('0' + v);
+    }
+
+    size_t len = tmp + sizeof(tmp) - p;
+    memcpy(out, p, len);
+    return out + len;
 }
 
-#define execute(...) null_terminated_immediates(__VA_ARGS__, NULL)     // Asserts NULL termination
+static inline char* encode_csi(char* out, int n, char final) {
+    *out++ = '\033';
+    *out++ = '[';
+    out = encode_uint(out, n);
+    *out++ = final;
+    return out;
+}
 
+static inline char* encode_csi2(char* out, int a, int b, char final) {
+    *out++ = '\033';
+    *out++ = '[';
+    out = encode_uint(out, a);
+    *out++ = ';';
+    out = encode_uint(out, b);
+    *out++ = final;
+    return out;
+}
 
+static inline char* encode_setcur(char* out, int row, int col)         { return encode_csi2(out, row, col, 'H'); }
 
+static inline char* encode_colour(char* out, unsigned int colour, bool fg) {
+    *out++ = fg ? '3' : '4';
 
-// Input (cross platform)
+    switch (colour >> 24) {
+        case 1:                                                         // 38;5;n
+            memcpy(out, "8;5;", 4);
+            return encode_uint(out + 4, colour & 0xFF);
 
-void clear_seqd_input() {
-    if (seqdibuf != NULL)
-        if (!strchr(seqdibuf, '\n'))
-            while(fgetc(stdin)!='\n');                                  //discard until newline
+        case 2:                                                         // 38;2;r;g;b
+            memcpy(out, "8;2;", 4);
+            out = encode_uint(out + 4, (colour >> 16) & 0xFF);
+            *out++ = ';';
+            out = encode_uint(out, (colour >> 8) & 0xFF);
+            *out++ = ';';
+            return encode_uint(out, colour & 0xFF);
+
+        default:                                                        // 39, default colour
+            *out++ = '9';
+            return out;
+    }
 }
 
-static inline char* get_input(int max_size) {
-    clear_seqd_input();
-    seqdibuf = (char*) realloc(seqdibuf, max_size+1);
-    memset(seqdibuf, 0, max_size+1);                    // Clearing array
-    
-    // Read from stdin
-    fgets(seqdibuf, max_size+1, stdin);
+static inline int seqd_utf8_encode(unsigned int cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char) cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char) (0xC0 | (cp >> 6));
+        out[1] = (char) (0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char) (0xE0 | (cp >> 12));
+        out[1] = (char) (0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char) (0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char) (0xF0 | (cp >> 18));
+    out[1] = (char) (0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char) (0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char) (0x80 | (cp & 0x3F));
+    return 4;
+}
 
-    return seqdibuf;
+static inline unsigned int seqd_utf8_decode(const char** s) {
+    const unsigned char* p = (const unsigned char*) *s;
+    unsigned int cp;
+    int extra;
+
+    if (p[0] < 0x80)                { cp = p[0];        extra = 0; }
+    else if ((p[0] & 0xE0) == 0xC0) { cp = p[0] & 0x1F; extra = 1; }
+    else if ((p[0] & 0xF0) == 0xE0) { cp = p[0] & 0x0F; extra = 2; }
+    else if ((p[0] & 0xF8) == 0xF0) { cp = p[0] & 0x07; extra = 3; }
+    else {
+        *s += 1;
+        return 0xFFFD;
+    }
+
+    for (int i = 1; i <= extra; i++) {
+        if ((p[i] & 0xC0) != 0x80) {                                    // Truncated sequence, also stops at the null terminator
+            *s += i;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+
+    *s += extra + 1;
+    return cp;
 }
 
+////////////////////////// Cross platform functions /////////////////////////// 
+
 
-// Cursor/console commands
 
-static inline void get_terminal_size(int* width, int* height) {
-    if (!seqdraw)                           // Only works in raw mode, this variable is defined 
-        return;                             // later on next to the functions for setting raw
-
-
-    // Send escape sequence to request cursor position
-    immediate(SEQD_SETCUR(999,999));
-    immediate(SEQD_CURPOS);
-
-    /*
-    // Read the response
-    char buf[32];
-    if (fgets(buf, sizeof(buf), stdin) != NULL) {
-        // The format will be like: ESC[row;colR
-        // Example: ESC[5;10R means row 5, column 10
-        int row, col;
-        if (sscanf(buf, SEQD_ESC "[%d;%dR", &row, &col) == 2) {
-            return row;
-        }
+// Buffering sequences to be executed later (when display() is called)
+// The seqd_ versions work on any context, the short names use seqdctx.
+
+static inline void seqd_context_free(seqd_context* ctx) {
+    free(ctx->buf);
+    ctx->buf = NULL;
+    ctx->size = 0;
+    ctx->capacity = 0;
+    ctx->pen_known = false;
+
+    while (ctx->arena != NULL) {
+        seqd_arena_block* prev = ctx->arena->prev;
+        free(ctx->arena);
+        ctx->arena = prev;
     }
+}
+
+static inline void seqd_display(seqd_context* ctx) {
+    seqd_arena_reset(ctx);                              // Queued output was copied into buf, nothing in the arena is needed to write it
 
-    return -1;
-    */
+    if (ctx->buf == NULL)
+        return;
 
-    char buf[11];
-    ssize_t len = read(STDIN_FILENO, buf, sizeof(buf) - 1);
+    #ifdef SEQD_STATS
+        unsigned long long start = seqd_clock_ns();
+        unsigned long long calls = seqdwrite_calls;
+    #endif
 
-    if (len > 0) {
-        buf[len] = '\0';  // Null-terminate so sscanf works
-        int row, col;
-        if (sscanf(buf, "\033[%d;%dR", &row, &col) == 2) {
-            *width = col;
-            *height = row;
-        }
+    fflush(stdout);                                     // Anything printed through stdio goes out first, so the order is kept
+
+    if (seqdframe == 0) {
+        write_all(seqdout, ctx->buf, ctx->size);
+    } else {
+        // Frame mode, the markers and the frame go out together in one writev
+        seqd_segment frame[5];
+        int count = 0;
+
+        if (seqdframe & SEQD_FRAME_SYNC)
+            frame[count++] = (seqd_segment) { SEQD_SYNC_BEGIN, sizeof(SEQD_SYNC_BEGIN) - 1 };
+        if (seqdframe & SEQD_FRAME_HIDE_CURSOR)
+            frame[count++] = (seqd_segment) { SEQD_HIDECUR, sizeof(SEQD_HIDECUR) - 1 };
+
+        frame[count++] = (seqd_segment) { ctx->buf, ctx->size };
+
+        if (seqdframe & SEQD_FRAME_HIDE_CURSOR)
+            frame[count++] = (seqd_segment) { SEQD_SHOWCUR, sizeof(SEQD_SHOWCUR) - 1 };
+        if (seqdframe & SEQD_FRAME_SYNC)
+            frame[count++] = (seqd_segment) { SEQD_SYNC_END, sizeof(SEQD_SYNC_END) - 1 };
+
+        write_segments(seqdout, frame, count);
     }
+
+    #ifdef SEQD_STATS
+        seqd_stats* s = &ctx->stats;
+        unsigned long long took = seqd_clock_ns() - start;
+
+        s->frames++;
+        s->bytes_written += ctx->size;
+        s->last_frame_bytes = ctx->size;
+        s->max_frame_bytes = ctx->size > s->max_frame_bytes ? ctx->size : s->max_frame_bytes;
+        s->write_calls += seqdwrite_calls - calls;
+        s->flush_ns += took;
+        s->last_flush_ns = took;
+        s->max_flush_ns = took > s->max_flush_ns ? took : s->max_flush_ns;
+    #endif
 }
 
-///////////////////////// Platform specific functions ///////////////////////// 
-// These are a little harder to read. Dependencies and any globals are       //
-// included at the top of this section. Globals are prefixed with seqd_.     //
-//                                                                           //
-// There's a comment with whitespace to indicate what each sub-section is    //
-// responsible for.                                                          //
-///////////////////////////////////////////////////////////////////////////////
+static inline bool seqd_reserve(seqd_context* ctx, unsigned int size) {
+    if (ctx->buf != NULL && size < ctx->capacity)       // One byte is always kept for the null terminator
+        return true;
 
-// Raw mode
- 
-static inline void set_raw_mode() {
+    if (size > UINT_MAX / 2)                            // Doubling past this would wrap round to 0
+        return false;
 
-    #ifdef _WIN32                           // WINDOWS implementation
-                
-            // Disable input buffering and character echo
-            HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
+    unsigned int capacity = ctx->capacity ? ctx->capacity : SEQD_BUFFER_INITIAL_CAPACITY;
+    while (capacity <= size)                            // Geometric growth keeps appends amortized O(1)
+        capacity *= 2;
 
-            // Get current console input mode
-            if (!GetConsoleMode(hstdin, &seqdmode)) {
-                perror("GetConsoleMode");
-                exit(EXIT_FAILURE);
-            }
+    char* grown = (char*) realloc(ctx->buf, capacity);
+    if (grown == NULL)                                  // The old buffer is left untouched on failure
+        return false;
 
-            // Disable line input and echo
-            DWORD new_mode = seqdmode & ~(ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT);
-            if (!SetConsoleMode(hstdin, new_mode)) {
-                perror("SetConsoleMode");
-                exit(EXIT_FAILURE);
-            }
+    if (ctx->buf == NULL)
+        grown[0] = '\0';
 
-    #else                                       // POSIX implementation
+    ctx->buf = grown;
+    ctx->capacity = capacity;
+    return true;
+}
 
-            // Get the current terminal settings
-            //struct termios term = { 0 };
-            fflush(stdout);
+static inline void seqd_clear(seqd_context* ctx) {
+    ctx->size = 0;
+    if (ctx->buf != NULL)
+        ctx->buf[0] = '\0';
+}
 
-            if (tcgetattr(STDIN_FILENO, &seqdterm) < 0)
-                perror("tcgetattr");
+static inline char* seqd_buffer_n(seqd_context* ctx, const char* sequence, unsigned int length) {
+    if (length > UINT_MAX / 2 || !seqd_reserve(ctx, ctx->size + length)) // size is at most UINT_MAX / 2, so the sum can't wrap
+        return NULL;
 
-            // Save the original terminal settings for later restoration
-            //seqdterm = term;
-            struct termios term = seqdterm;
+    memcpy(ctx->buf + ctx->size, sequence, length);     // Append at the tracked end instead of rescanning with strcat
+    SEQD_STAT(ctx->stats.sequences++; ctx->stats.bytes_queued += length);
+    ctx->size += length;
+    ctx->buf[ctx->size] = '\0';
+    return ctx->buf;
+}
 
-            // Set the terminal to raw mode
-            term.c_lflag &= ~(ICANON | ECHO);  // Disable canonical mode and echo
-            term.c_cc[VMIN] = 1;               // Minimum number of bytes for non-canonical mode
-            term.c_cc[VTIME] = 0;              // Timeout for non-canonical mode
+static inline char* seqd_buffer(seqd_context* ctx, const char* sequence) {
+    return seqd_buffer_n(ctx, sequence, strnlen(sequence, SEQD_MAX_BUFFER_SIZE));
+}
 
-            if (tcsetattr(STDIN_FILENO, TCSANOW, &term) < 0)
-                perror("tcsetattr");
+static inline char* seqd_append(seqd_context* dst, const seqd_context* src) {
+    if (src->buf == NULL)
+        return dst->buf;
 
-    #endif
-    
-    seqdraw = true;
+    return seqd_buffer_n(dst, src->buf, src->size);
 }
 
+static inline void display()                                            { seqd_display(&seqdctx); }
+static inline bool reserve_buffer(unsigned int size)                    { return seqd_reserve(&seqdctx, size); }
+static inline void clear_buffer()                                       { seqd_clear(&seqdctx); }
+static inline char* buffer_n(const char* sequence, unsigned int length) { return seqd_buffer_n(&seqdctx, sequence, length); }
+static inline char* buffer(const char* sequence)                        { return seqd_buffer(&seqdctx, sequence); }
 
-static inline void unset_raw_mode() {
+// Sequences encoded straight into the buffer, the encoders above never write more than 32 bytes
 
-    #ifdef _WIN32
+static inline char* seqd_tail(seqd_context* ctx, unsigned int size) {   // Reserves size more bytes and returns where they start, NULL on failure
+    if (!seqd_reserve(ctx, ctx->size + size))
+        return NULL;
 
-        HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
+    return ctx->buf + ctx->size;
+}
 
-        if (!SetConsoleMode(hstdin, seqdmode)) {
-            perror("SetConsoleMode");
-            exit(EXIT_FAILURE);
-        }
+static inline char* seqd_commit(seqd_context* ctx, char* end) {         // Marks everything up to end as queued
+    SEQD_STAT(ctx->stats.sequences++; ctx->stats.bytes_queued += (unsigned int) (end - ctx->buf) - ctx->size);
+    ctx->size = (unsigned int) (end - ctx->buf);
+    *end = '\0';
+    return ctx->buf;
+}
 
-    #else       // POSIX implementation
+static inline char* seqd_csi(seqd_context* ctx, int n, char final) {
+    char* out = seqd_tail(ctx, 32);
+    return out ? seqd_commit(ctx, encode_csi(out, n, final)) : NULL;
+}
 
-        if (tcsetattr(STDIN_FILENO, TCSANOW, &seqdterm) < 0)
-            perror("tcsetattr");
+static inline char* seqd_setcur(seqd_context* ctx, int row, int col) {
+    char* out = seqd_tail(ctx, 32);
+    return out ? seqd_commit(ctx, encode_setcur(out, row, col)) : NULL;
+}
 
-    #endif
+static inline char* seqd_scroll_region(seqd_context* ctx, int top, int bottom) {
+    char* out = seqd_tail(ctx, 32);
+    return out ? seqd_commit(ctx, encode_csi2(out, top, bottom, 'r')) : NULL;
+}
 
-    seqdraw = false;
+static inline char* seqd_sgr_colour(seqd_context* ctx, unsigned int colour, bool fg) {
+    char* out = seqd_tail(ctx, 32);
+    if (out == NULL)
+        return NULL;
 
+    *out++ = '\033';
+    *out++ = '[';
+    out = encode_colour(out, colour, fg);
+    *out++ = 'm';
+    return seqd_commit(ctx, out);
 }
 
+static inline char* seqd_fg_256(seqd_context* ctx, int col)             { return seqd_sgr_colour(ctx, SEQD_COLOUR_256(col), true); }
+static inline char* seqd_bg_256(seqd_context* ctx, int col)             { return seqd_sgr_colour(ctx, SEQD_COLOUR_256(col), false); }
+static inline char* seqd_fg_rgb(seqd_context* ctx, int r, int g, int b) { return seqd_sgr_colour(ctx, SEQD_COLOUR_RGB(r, g, b), true); }
+static inline char* seqd_bg_rgb(seqd_context* ctx, int r, int g, int b) { return seqd_sgr_colour(ctx, SEQD_COLOUR_RGB(r, g, b), false); }
 
+static inline char* buffer_csi(int n, char final)                       { return seqd_csi(&seqdctx, n, final); }
+static inline char* buffer_setcur(int row, int col)                     { return seqd_setcur(&seqdctx, row, col); }
+static inline char* buffer_scroll_region(int top, int bottom)           { return seqd_scroll_region(&seqdctx, top, bottom); }
+static inline char* buffer_fg_256(int col)                              { return seqd_fg_256(&seqdctx, col); }
+static inline char* buffer_bg_256(int col)                              { return seqd_bg_256(&seqdctx, col); }
+static inline char* buffer_fg_rgb(int r, int g, int b)                  { return seqd_fg_rgb(&seqdctx, r, g, b); }
+static inline char* buffer_bg_rgb(int r, int g, int b)                  { return seqd_bg_rgb(&seqdctx, r, g, b); }
 
-// Input (non-blocking)
+static inline void null_terminated_buffers(const char* first, ...) { 
+    va_list args;
+    va_start(args, first);
 
-static inline char keypress() {
+    const char* sequence = first;
 
-    #ifdef _WIN32                   // WINDOWS implementation
+    do {
+        buffer(sequence);
+        sequence = va_arg(args, const char*);
+    } while (sequence != NULL);
+}
 
-        if (_kbhit())
-            return _getch();
-        return 0;
+#define queue(...) null_terminated_buffers(__VA_ARGS__, NULL)          // Asserts NULL termination
+#define queue_const(literal) buffer_n("" literal, sizeof(literal) - 1)  // The "" makes anything that isn't a string literal fail to compile
 
-    #else                           // POSIX implementation
-        // Non-blocking read only works in raw mode, for blocking reads there is a separate function
-        if (!seqdraw)
-            return 0;
 
-        // Check if there is char in stdin
-        if (feof(stdin) != 0) {
-            clearerr(stdin);
-            return 0;
-        }
 
-        // Read char from stdin
-        struct pollfd fds;
-        fds.fd = STDIN_FILENO; 
-        fds.events = POLLIN;
+// Attribute state
 
-        if (poll(&fds, 1, SEQD_KEYBOARD_TIMEOUT)) {
-            char c;
-            ssize_t n = read(STDIN_FILENO, &c, 1);
+static inline char* sgr_params(char* p, seqd_attr from, seqd_attr to) { // Writes the parameters (each followed by ';') that take from to to without a reset, returns the end
+    static const char on[8] = { '1', '2', '3', '4', '5', '7', '8', '9' }; // Same order as the SEQD_STYLE_ bits
+    unsigned int off = from.style & ~to.style;
 
-            if (n == 1)
-                return (char) c;
+    if (off & (SEQD_STYLE_BOLD | SEQD_STYLE_FAINT)) {                   // 22 turns both off, whichever should stay on is sent again below
+        memcpy(p, "22;", 3);
+        p += 3;
+        from.style &= ~(SEQD_STYLE_BOLD | SEQD_STYLE_FAINT);
+    }
+
+    for (int i = 2; i < 8; i++) {                                       // The rest each have their own off code, 20 more than the on code
+        if (off & (1u << i)) {
+            *p++ = '2';
+            *p++ = on[i];
+            *p++ = ';';
         }
+    }
 
-        return 0;
+    for (int i = 0; i < 8; i++) {
+        if ((to.style & ~from.style) & (1u << i)) {
+            *p++ = on[i];
+            *p++ = ';';
+        }
+    }
 
+    if (from.fg != to.fg) {
+        p = encode_colour(p, to.fg, true);
+        *p++ = ';';
+    }
+
+    if (from.bg != to.bg) {
+        p = encode_colour(p, to.bg, false);
+        *p++ = ';';
+    }
+
+    return p;
+}
+
+static inline int sgr_transition(char* out, seqd_attr from, seqd_attr to) {
+    if (from.fg == to.fg && from.bg == to.bg && from.style == to.style)
+        return 0;
+
+    seqd_attr defaults = { SEQD_COLOUR_DEFAULT, SEQD_COLOUR_DEFAULT, 0 };
+    char reset[64];
+    char* p = out;
+    *p++ = '\033';
+    *p++ = '[';
+
+    // Going through a reset (ESC[0;...m) is shorter when most of from has to go, and the
+    // only way when from's style isn't known (bits beyond the SEQD_STYLE_ set)
+    reset[0] = '0';
+    reset[1] = ';';
+    int reset_len = (int) (sgr_params(reset + 2, defaults, to) - reset);
+
+    if (from.style & ~0xFFu) {
+        memcpy(p, reset, reset_len);
+        p += reset_len;
+    } else {
+        p = sgr_params(p, from, to);
+
+        if (reset_len < p - (out + 2)) {
+            memcpy(out + 2, reset, reset_len);
+            p = out + 2 + reset_len;
+        }
+    }
+
+    p[-1] = 'm';                                                        // Replaces the trailing ';'
+    *p = '\0';
+    return (int) (p - out);
+}
+
+static inline void seqd_sgr_fg(seqd_context* ctx, unsigned int colour)         { ctx->pending.fg = colour; }
+static inline void seqd_sgr_bg(seqd_context* ctx, unsigned int colour)         { ctx->pending.bg = colour; }
+static inline void seqd_sgr_style(seqd_context* ctx, unsigned int style)       { ctx->pending.style = style; }
+static inline void seqd_sgr_style_on(seqd_context* ctx, unsigned int style)    { ctx->pending.style |= style; }
+static inline void seqd_sgr_style_off(seqd_context* ctx, unsigned int style)   { ctx->pending.style &= ~style; }
+static inline void seqd_sgr_set(seqd_context* ctx, seqd_attr attr)             { ctx->pending = attr; }
+static inline void seqd_sgr_invalidate(seqd_context* ctx)                      { ctx->pen_known = false; }
+
+static inline void seqd_sgr_reset(seqd_context* ctx) {
+    seqd_attr defaults = { SEQD_COLOUR_DEFAULT, SEQD_COLOUR_DEFAULT, 0 };
+    ctx->pending = defaults;
+}
+
+static inline void seqd_sgr_flush(seqd_context* ctx) {
+    char seq[64];
+    int len;
+
+    if (ctx->pen_known) {
+        len = sgr_transition(seq, ctx->pen, ctx->pending);
+    } else {                                                            // Unknown state, reset first then set everything that isn't a default
+        seqd_attr unknown = { SEQD_COLOUR_DEFAULT, SEQD_COLOUR_DEFAULT, ~0u };
+        len = sgr_transition(seq, unknown, ctx->pending);
+    }
+
+    if (len > 0)
+        seqd_buffer_n(ctx, seq, len);
+
+    SEQD_STAT(if (len > 0) ctx->stats.sgr_changes++; else ctx->stats.sgr_elided++);
+
+    ctx->pen = ctx->pending;
+    ctx->pen_known = true;
+}
+
+static inline void seqd_sgr_text(seqd_context* ctx, const char* text) {
+    seqd_sgr_flush(ctx);
+    seqd_buffer(ctx, text);
+}
+
+static inline void sgr_fg(unsigned int colour)                          { seqd_sgr_fg(&seqdctx, colour); }
+static inline void sgr_bg(unsigned int colour)                          { seqd_sgr_bg(&seqdctx, colour); }
+static inline void sgr_style(unsigned int style)                        { seqd_sgr_style(&seqdctx, style); }
+static inline void sgr_style_on(unsigned int style)                     { seqd_sgr_style_on(&seqdctx, style); }
+static inline void sgr_style_off(unsigned int style)                    { seqd_sgr_style_off(&seqdctx, style); }
+static inline void sgr_set(seqd_attr attr)                              { seqd_sgr_set(&seqdctx, attr); }
+static inline void sgr_invalidate()                                     { seqd_sgr_invalidate(&seqdctx); }
+static inline void sgr_reset()                                          { seqd_sgr_reset(&seqdctx); }
+static inline void sgr_flush()                                          { seqd_sgr_flush(&seqdctx); }
+static inline void sgr_text(const char* text)                           { seqd_sgr_text(&seqdctx, text); }
+
+
+
+// Immediately displaying sequences
+
+static inline void immediate(const char* sequence) {                    // Immediate flushing
+    fflush(stdout);
+    write_all(seqdout, sequence, strlen(sequence));
+} 
+
+
+static inline void null_terminated_immediates(const char* first, ...) { 
+    va_list args;
+    va_start(args, first);
+
+    const char* sequence = first;
+
+    do {
+        immediate(sequence);
+        sequence = va_arg(args, const char*);
+    } while (sequence != NULL);
+}
+
+#define execute(...) null_terminated_immediates(__VA_ARGS__, NULL)     // Asserts NULL termination
+
+
+
+
+// Input (cross platform)
+
+static const struct { const char* sequence; int code; } seqd_keytable[] = {  // Escape sequences with the modifier parameter taken out, see decode_key
+    { SEQD_KEY_UP,          SEQD_KEYCODE_UP },
+    { SEQD_KEY_DOWN,        SEQD_KEYCODE_DOWN },
+    { SEQD_KEY_RIGHT,       SEQD_KEYCODE_RIGHT },
+    { SEQD_KEY_LEFT,        SEQD_KEYCODE_LEFT },
+    { SEQD_KEY_INSERT,      SEQD_KEYCODE_INSERT },
+    { SEQD_KEY_DELETE,      SEQD_KEYCODE_DELETE },
+    { SEQD_KEY_HOME,        SEQD_KEYCODE_HOME },
+    { SEQD_KEY_END,         SEQD_KEYCODE_END },
+    { SEQD_KEY_PAGE_UP,     SEQD_KEYCODE_PAGE_UP },
+    { SEQD_KEY_PAGE_DOWN,   SEQD_KEYCODE_PAGE_DOWN },
+
+    // Other spellings terminals use for the same keys
+    { "\033OA",             SEQD_KEYCODE_UP },
+    { "\033OB",             SEQD_KEYCODE_DOWN },
+    { "\033OC",             SEQD_KEYCODE_RIGHT },
+    { "\033OD",             SEQD_KEYCODE_LEFT },
+    { "\033OH",             SEQD_KEYCODE_HOME },
+    { "\033OF",             SEQD_KEYCODE_END },
+    { "\033[1~",            SEQD_KEYCODE_HOME },
+    { "\033[4~",            SEQD_KEYCODE_END },
+    { "\033[7~",            SEQD_KEYCODE_HOME },
+    { "\033[8~",            SEQD_KEYCODE_END },
+
+    // Function keys
+    { "\033OP",             SEQD_KEYCODE_F(1) },
+    { "\033OQ",             SEQD_KEYCODE_F(2) },
+    { "\033OR",             SEQD_KEYCODE_F(3) },
+    { "\033OS",             SEQD_KEYCODE_F(4) },
+    { "\033[P",             SEQD_KEYCODE_F(1) },
+    { "\033[Q",             SEQD_KEYCODE_F(2) },
+    { "\033[R",             SEQD_KEYCODE_F(3) },
+    { "\033[S",             SEQD_KEYCODE_F(4) },
+    { "\033[11~",           SEQD_KEYCODE_F(1) },
+    { "\033[12~",           SEQD_KEYCODE_F(2) },
+    { "\033[13~",           SEQD_KEYCODE_F(3) },
+    { "\033[14~",           SEQD_KEYCODE_F(4) },
+    { "\033[15~",           SEQD_KEYCODE_F(5) },
+    { "\033[17~",           SEQD_KEYCODE_F(6) },
+    { "\033[18~",           SEQD_KEYCODE_F(7) },
+    { "\033[19~",           SEQD_KEYCODE_F(8) },
+    { "\033[20~",           SEQD_KEYCODE_F(9) },
+    { "\033[21~",           SEQD_KEYCODE_F(10) },
+    { "\033[23~",           SEQD_KEYCODE_F(11) },
+    { "\033[24~",           SEQD_KEYCODE_F(12) },
+};
+
+static inline int decode_utf8_key(const char* bytes, int length, bool complete, seqd_key* key) {
+    const unsigned char* p = (const unsigned char*) bytes;
+    int extra = p[0] >= 0xF0 ? 3 : p[0] >= 0xE0 ? 2 : p[0] >= 0xC0 ? 1 : 0;
+
+    if (p[0] >= 0x80 && extra == 0) {                                   // Stray continuation byte
+        key->code = 0xFFFD;
+        return 1;
+    }
+
+    if (length <= extra)
+        return complete ? (key->code = 0xFFFD, 1) : 0;
+
+    int code = extra == 0 ? p[0] : p[0] & (0x3F >> extra);
+    for (int i = 1; i <= extra; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            key->code = 0xFFFD;
+            return i;
+        }
+        code = (code << 6) | (p[i] & 0x3F);
+    }
+
+    key->code = code;
+    return extra + 1;
+}
+
+static inline int decode_key(const char* bytes, int length, bool complete, seqd_key* key) {
+    key->code = 0;
+    key->mods = 0;
+
+    if (length <= 0)
+        return 0;
+
+    if (bytes[0] == '\0') {                                             // Ctrl + Space (and Ctrl + @) send NUL
+        key->code = ' ';
+        key->mods = SEQD_MOD_CTRL;
+        return 1;
+    }
+
+    if (bytes[0] != SEQD_KEY_ESC)
+        return decode_utf8_key(bytes, length, complete, key);
+
+    // ESC on its own, or the start of a sequence - wait for more unless told there is none
+    if (length == 1) {
+        if (!complete)
+            return 0;
+
+        key->code = SEQD_KEY_ESC;
+        return 1;
+    }
+
+    if (bytes[1] != '[' && bytes[1] != 'O') {                           // ESC + key is Alt + key
+        int used = decode_key(bytes + 1, length - 1, complete, key);
+        key->mods |= SEQD_MOD_ALT;
+        return used ? used + 1 : 0;
+    }
+
+    // CSI (ESC [) runs until a final byte, SS3 (ESC O) is always one byte long
+    char plain[16];
+    int end = 2;
+    if (bytes[1] == '[') {
+        while (end < length && (unsigned char) bytes[end] >= 0x20 && (unsigned char) bytes[end] < 0x40)
+            end++;
+    }
+
+    if (end >= length) {
+        if (!complete)
+            return 0;
+
+        if (end > 2) {                                                  // A sequence that never finished, none of it is a key
+            key->code = SEQD_KEYCODE_UNKNOWN;
+            return end;
+        }
+
+        key->code = (unsigned char) bytes[1];                           // Only ESC [ or ESC O arrived, so it was Alt + [ or Alt + O
+        key->mods = SEQD_MOD_ALT;
+        return 2;
+    }
+
+    if ((unsigned char) bytes[end] < 0x40 || (unsigned char) bytes[end] > 0x7E) { // Cut short by ESC or another control
+        if (end == 2) {
+            key->code = (unsigned char) bytes[1];
+            key->mods = SEQD_MOD_ALT;
+            return 2;
+        }
+
+        key->code = SEQD_KEYCODE_UNKNOWN;                               // What was read is dropped, whatever cut it short is decoded next
+        return end;
+    }
+
+    // Take the modifier parameter out, ESC[1;5A becomes ESC[A and ESC[3;2~ becomes ESC[3~
+    int plain_len = 0;
+    int mod = 0;
+    const char* semicolon = (const char*) memchr(bytes, ';', end);
+
+    if (semicolon != NULL) {
+        mod = atoi(semicolon + 1);
+
+        int first = (int) (semicolon - bytes);
+        bool only_one = first == 3 && bytes[2] == '1' && bytes[end] != '~'; // ESC[1;5A drops the 1 as well, but ESC[1;5~ is Home
+        plain_len = only_one ? 2 : first;
+    } else {
+        plain_len = end;
+    }
+
+    if (plain_len + 2 <= (int) sizeof(plain)) {
+        memcpy(plain, bytes, plain_len);
+        plain[plain_len++] = bytes[end];
+        plain[plain_len] = '\0';
+
+        for (size_t i = 0; i < sizeof(seqd_keytable) / sizeof(seqd_keytable[0]); i++) {
+            if (strcmp(plain, seqd_keytable[i].sequence) == 0) {
+                key->code = seqd_keytable[i].code;
+                break;
+            }
+        }
+    }
+
+    if (key->code == 0 && bytes[1] == '[' && bytes[end] == 'Z') {      // Shift + Tab
+        key->code = SEQD_KEY_TAB;
+        mod = 2;
+    }
+
+    if (key->code == 0) {                                               // Mouse reports and the like, their parameters aren't modifiers
+        key->code = SEQD_KEYCODE_UNKNOWN;
+        return end + 1;
+    }
+
+    if (mod > 1)
+        key->mods = (unsigned int) (mod - 1);
+
+    return end + 1;
+}
+
+static inline int read_stdin(char* buf, unsigned int size) {          // read() on stdin that retries EINTR, returns 0 at EOF and -1 on error
+    while (true) {
+        #ifdef _WIN32
+            int n = _read(0, buf, size);
+        #else
+            ssize_t n = read(STDIN_FILENO, buf, size);
+        #endif
+
+        if (n >= 0 || errno != EINTR)
+            return (int) n;
+    }
+}
+
+static inline int fill_line() {                                         // Makes room at the end of seqdline and reads into it, same returns as read_stdin
+    if (seqdline == NULL) {
+        seqdline = (char*) malloc(SEQD_LINE_BUFFER_SIZE + 1);          // +1 so a last line without '\n' can still be null terminated
+        if (seqdline == NULL)
+            return -1;
+    }
+
+    if (seqdline_start > 0) {
+        memmove(seqdline, seqdline + seqdline_start, seqdline_end - seqdline_start);
+        seqdline_end -= seqdline_start;
+        seqdline_start = 0;
+    }
+
+    int n = read_stdin(seqdline + seqdline_end, SEQD_LINE_BUFFER_SIZE - seqdline_end);
+    if (n > 0)
+        seqdline_end += n;
+
+    return n;
+}
+
+void clear_seqd_input() {
+    for (int i = 0; seqdline_skip && i < SEQD_MAX_GET_LINE_MAXIMUM_ITERATION; i++) {
+        char* newline = (char*) memchr(seqdline + seqdline_start, '\n', seqdline_end - seqdline_start);
+
+        if (newline != NULL) {
+            seqdline_start = (unsigned int) (newline - seqdline) + 1;
+            seqdline_skip = false;
+            break;
+        }
+
+        seqdline_start = seqdline_end;                                  // None of it is wanted
+        if (fill_line() <= 0)
+            seqdline_skip = false;                                      // EOF or error ends the line too
+    }
+
+    seqdline_scanned = 0;
+}
+
+static inline bool read_line(const char** line, unsigned int* length) {
+    while (seqdline_skip)                                               // Never hand back the middle of the line that was cut
+        clear_seqd_input();
+
+    seqdline_truncated = false;
+    seqdline_newline = false;
+
+    while (true) {
+        unsigned int available = seqdline_end - seqdline_start;
+
+        // Only the bytes that arrived since the last look are searched
+        char* newline = seqdline == NULL ? NULL :
+            (char*) memchr(seqdline + seqdline_start + seqdline_scanned, '\n', available - seqdline_scanned);
+
+        if (newline != NULL) {
+            *newline = '\0';
+            *line = seqdline + seqdline_start;
+            *length = (unsigned int) (newline - *line);
+
+            seqdline_start += *length + 1;
+            seqdline_scanned = 0;
+            seqdline_newline = true;
+            return true;
+        }
+
+        seqdline_scanned = available;
+
+        if (available == SEQD_LINE_BUFFER_SIZE) {                       // Too long, hand back what fits and drop the rest on the next call
+            seqdline[seqdline_end] = '\0';
+            *line = seqdline + seqdline_start;
+            *length = available;
+
+            seqdline_start = seqdline_end;
+            seqdline_scanned = 0;
+            seqdline_skip = true;
+            seqdline_truncated = true;
+            return true;
+        }
+
+        if (fill_line() > 0)                                            // seqdline_scanned counts from seqdline_start, so the move in fill_line keeps it right
+            continue;
+
+        if (available == 0)                                             // EOF (or an error) with nothing left over
+            return false;
+
+        seqdline[seqdline_end] = '\0';                                 // The last line had no '\n'
+        *line = seqdline + seqdline_start;
+        *length = available;
+
+        seqdline_start = seqdline_end;
+        seqdline_scanned = 0;
+        return true;
+    }
+}
+
+static inline char* get_input(int max_size) {
+    if (max_size < 0)
+        max_size = 0;
+
+    if (seqdibuf_size < max_size + 2) {                                 // Room for the '\n' and the null terminator, only ever grows
+        char* grown = (char*) realloc(seqdibuf, max_size + 2);
+        if (grown == NULL)
+            return seqdibuf;
+
+        seqdibuf = grown;
+        seqdibuf_size = max_size + 2;
+    }
+
+    const char* line;
+    unsigned int length;
+
+    if (!read_line(&line, &length)) {
+        seqdibuf[0] = '\0';
+        return seqdibuf;
+    }
+
+    // Same shape as fgets used to give, the '\n' is kept if there was one and the whole line fits
+    unsigned int copied = length < (unsigned int) max_size ? length : (unsigned int) max_size;
+    memcpy(seqdibuf, line, copied);
+
+    if (copied == length && seqdline_newline && copied < (unsigned int) max_size)
+        seqdibuf[copied++] = '\n';
+
+    seqdibuf[copied] = '\0';
+    return seqdibuf;
+}
+
+
+
+// Text measurement
+// Lone combining marks and malformed bytes are never merged with anything, so
+// widths can be off for text the terminal would draw strangely anyway. The
+// tables follow Unicode's East Asian Width, with emoji ranges counted as wide.
+
+static const struct { unsigned int first, last; unsigned char width; } seqd_widths[] = { // Sorted, anything missing is 1 column
+    { 0x0300,  0x036F,  0 }, { 0x0483,  0x0489,  0 }, { 0x0591,  0x05BD,  0 }, { 0x05BF,  0x05BF,  0 },
+    { 0x05C1,  0x05C2,  0 }, { 0x05C4,  0x05C5,  0 }, { 0x05C7,  0x05C7,  0 }, { 0x0610,  0x061A,  0 },
+    { 0x064B,  0x065F,  0 }, { 0x0670,  0x0670,  0 }, { 0x06D6,  0x06DC,  0 }, { 0x06DF,  0x06E4,  0 },
+    { 0x06E7,  0x06E8,  0 }, { 0x06EA,  0x06ED,  0 }, { 0x0900,  0x0902,  0 }, { 0x093A,  0x093A,  0 },
+    { 0x093C,  0x093C,  0 }, { 0x0941,  0x0948,  0 }, { 0x094D,  0x094D,  0 }, { 0x0951,  0x0957,  0 },
+    { 0x0962,  0x0963,  0 }, { 0x0E31,  0x0E31,  0 }, { 0x0E34,  0x0E3A,  0 }, { 0x0E47,  0x0E4E,  0 },
+    { 0x1100,  0x115F,  2 }, { 0x1160,  0x11FF,  0 }, { 0x1AB0,  0x1AFF,  0 }, { 0x1DC0,  0x1DFF,  0 },
+    { 0x200B,  0x200F,  0 }, { 0x202A,  0x202E,  0 }, { 0x2060,  0x2064,  0 }, { 0x20D0,  0x20FF,  0 },
+    { 0x231A,  0x231B,  2 }, { 0x2329,  0x232A,  2 }, { 0x23E9,  0x23EC,  2 }, { 0x23F0,  0x23F0,  2 },
+    { 0x23F3,  0x23F3,  2 }, { 0x25FD,  0x25FE,  2 }, { 0x2614,  0x2615,  2 }, { 0x2648,  0x2653,  2 },
+    { 0x267F,  0x267F,  2 }, { 0x2693,  0x2693,  2 }, { 0x26A1,  0x26A1,  2 }, { 0x26AA,  0x26AB,  2 },
+    { 0x26BD,  0x26BE,  2 }, { 0x26C4,  0x26C5,  2 }, { 0x26CE,  0x26CE,  2 }, { 0x26D4,  0x26D4,  2 },
+    { 0x26EA,  0x26EA,  2 }, { 0x26F2,  0x26F3,  2 }, { 0x26F5,  0x26F5,  2 }, { 0x26FA,  0x26FA,  2 },
+    { 0x26FD,  0x26FD,  2 }, { 0x2705,  0x2705,  2 }, { 0x270A,  0x270B,  2 }, { 0x2728,  0x2728,  2 },
+    { 0x274C,  0x274C,  2 }, { 0x274E,  0x274E,  2 }, { 0x2753,  0x2755,  2 }, { 0x2757,  0x2757,  2 },
+    { 0x2795,  0x2797,  2 }, { 0x27B0,  0x27B0,  2 }, { 0x27BF,  0x27BF,  2 }, { 0x2B1B,  0x2B1C,  2 },
+    { 0x2B50,  0x2B50,  2 }, { 0x2B55,  0x2B55,  2 }, { 0x2E80,  0x303E,  2 }, { 0x3041,  0x33FF,  2 },
+    { 0x3400,  0x4DBF,  2 }, { 0x4E00,  0x9FFF,  2 }, { 0xA000,  0xA4CF,  2 }, { 0xA960,  0xA97F,  2 },
+    { 0xAC00,  0xD7A3,  2 }, { 0xF900,  0xFAFF,  2 }, { 0xFE00,  0xFE0F,  0 }, { 0xFE10,  0xFE19,  2 },
+    { 0xFE20,  0xFE2F,  0 }, { 0xFE30,  0xFE6F,  2 }, { 0xFEFF,  0xFEFF,  0 }, { 0xFF00,  0xFF60,  2 },
+    { 0xFFE0,  0xFFE6,  2 }, { 0x16FE0, 0x16FE4, 2 }, { 0x17000, 0x18CFF, 2 }, { 0x1B000, 0x1B2FF, 2 },
+    { 0x1F004, 0x1F004, 2 }, { 0x1F0CF, 0x1F0CF, 2 }, { 0x1F18E, 0x1F18E, 2 }, { 0x1F191, 0x1F19A, 2 },
+    { 0x1F200, 0x1F251, 2 }, { 0x1F300, 0x1F64F, 2 }, { 0x1F680, 0x1F6FF, 2 }, { 0x1F900, 0x1F9FF, 2 },
+    { 0x1FA70, 0x1FAFF, 2 }, { 0x20000, 0x2FFFD, 2 }, { 0x30000, 0x3FFFD, 2 }, { 0xE0001, 0xE007F, 0 },
+    { 0xE0100, 0xE01EF, 0 },
+};
+
+static inline int char_width(unsigned int cp) {
+    if (cp < 0x7F)
+        return cp >= 0x20;
+    if (cp < 0xA0)                                                      // DEL and the C1 controls
+        return 0;
+    if (cp < seqd_widths[0].first)
+        return 1;
+
+    int low = 0;
+    int high = (int) (sizeof(seqd_widths) / sizeof(seqd_widths[0])) - 1;
+
+    while (low <= high) {
+        int mid = (low + high) / 2;
+
+        if (cp < seqd_widths[mid].first)
+            high = mid - 1;
+        else if (cp > seqd_widths[mid].last)
+            low = mid + 1;
+        else
+            return seqd_widths[mid].width;
+    }
+
+    return 1;
+}
+
+#ifdef SEQD_SIMD_WIDTH
+static inline unsigned int seqd_first_bit(unsigned int mask) {          // Index of the lowest set bit, mask can't be 0
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned int) index;
+    #else
+        return (unsigned int) __builtin_ctz(mask);
+    #endif
+}
+#endif
+
+static inline size_t seqd_ascii_run(const char* utf8, size_t size) {   // Length of the leading run of printable ASCII (0x20 to 0x7E), where bytes and columns are the same
+    size_t i = 0;
+
+    #if SEQD_SIMD_WIDTH == 32
+        const __m256i space = _mm256_set1_epi8(0x20);
+        const __m256i del = _mm256_set1_epi8(0x7F);
+
+        for (; i + 32 <= size; i += 32) {
+            __m256i bytes = _mm256_loadu_si256((const __m256i*) (utf8 + i));
+            // Signed compare, so bytes of 0x80 and up count as below space too
+            __m256i stop = _mm256_or_si256(_mm256_cmpgt_epi8(space, bytes), _mm256_cmpeq_epi8(bytes, del));
+            unsigned int mask = (unsigned int) _mm256_movemask_epi8(stop);
+
+            if (mask != 0)
+                return i + seqd_first_bit(mask);
+        }
+    #elif SEQD_SIMD_WIDTH == 16
+        const __m128i space = _mm_set1_epi8(0x20);
+        const __m128i del = _mm_set1_epi8(0x7F);
+
+        for (; i + 16 <= size; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*) (utf8 + i));
+            // Signed compare, so bytes of 0x80 and up count as below space too
+            __m128i stop = _mm_or_si128(_mm_cmplt_epi8(bytes, space), _mm_cmpeq_epi8(bytes, del));
+            unsigned int mask = (unsigned int) _mm_movemask_epi8(stop);
+
+            if (mask != 0)
+                return i + seqd_first_bit(mask);
+        }
+    #endif
+
+    while (i < size && utf8[i] >= 0x20 && utf8[i] < 0x7F)             // The tail, or everything without SIMD (char being signed or not doesn't matter here)
+        i++;
+
+    return i;
+}
+
+static inline size_t text_fit(const char* utf8, size_t size, int columns, int* used) {
+    size_t i = 0;
+    int width = 0;
+
+    if (columns < 0)
+        columns = 0;
+
+    while (i < size) {
+        size_t run = seqd_ascii_run(utf8 + i, size - i);
+
+        if (run > (size_t) (columns - width))
+            run = (size_t) (columns - width);
+
+        i += run;
+        width += (int) run;
+
+        if (i >= size)
+            break;
+
+        seqd_key key;                                                   // decode_utf8_key never reads past size, unlike seqd_utf8_decode
+        int length = decode_utf8_key(utf8 + i, (int) (size - i < 4 ? size - i : 4), true, &key);
+        int cw = char_width((unsigned int) key.code);
+
+        if (width + cw > columns)                                       // Zero width marks still join the last character that fit
+            break;
+
+        i += length;
+        width += cw;
+    }
+
+    if (used != NULL)
+        *used = width;
+
+    return i;
+}
+
+static inline int text_width(const char* utf8, size_t size) {
+    int width = 0;
+    text_fit(utf8, size, 0x7FFFFFFF, &width);
+    return width;
+}
+
+static inline char* seqd_text(seqd_context* ctx, const char* utf8, size_t size, int columns) {
+    static const char spaces[] = "                                ";
+    int width = 0;
+    size_t fit = text_fit(utf8, size, columns, &width);
+
+    char* result = seqd_buffer_n(ctx, utf8, (unsigned int) fit);
+
+    for (int pad = columns - width; pad > 0 && result != NULL; pad -= (int) sizeof(spaces) - 1)
+        result = seqd_buffer_n(ctx, spaces, pad < (int) sizeof(spaces) - 1 ? pad : (int) sizeof(spaces) - 1);
+
+    return result;
+}
+
+static inline char* buffer_text(const char* utf8, size_t size, int columns) { return seqd_text(&seqdctx, utf8, size, columns); }
+
+
+
+// Cursor/console commands
+
+static inline bool take_cursor_report(int* row, int* col) {            // Finds an ESC[row;colR in seqdin and removes it, leaving any keys around it
+    for (int i = seqdin_start; i + 6 <= seqdin_end; i++) {              // The shortest report is ESC[1;1R
+        if (seqdin[i] != '\033' || seqdin[i + 1] != '[')
+            continue;
+
+        int j = i + 2, values[2] = { 0, 0 }, digits[2] = { 0, 0 };
+        for (int v = 0; v < 2; v++) {
+            while (j < seqdin_end && seqdin[j] >= '0' && seqdin[j] <= '9' && digits[v] < 6) {
+                values[v] = values[v] * 10 + (seqdin[j++] - '0');
+                digits[v]++;
+            }
+            if (j >= seqdin_end || seqdin[j] != (v == 0 ? ';' : 'R'))
+                break;
+            j++;
+
+            if (v == 1 && digits[0] > 0 && digits[1] > 0) {
+                *row = values[0];
+                *col = values[1];
+                memmove(seqdin + i, seqdin + j, seqdin_end - j);
+                seqdin_end -= j - i;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static inline void get_terminal_size(int* width, int* height) {
+    if (!seqdsize_watched)
+        watch_terminal_size();
+
+    if (seqdsize_watched && !seqdsize_stale && seqdwidth > 0) {        // Nothing has changed since the last time
+        *width = seqdwidth;
+        *height = seqdheight;
+        return;
+    }
+
+    int w = 0, h = 0;
+    seqdsize_stale = 0;                                                 // Cleared first, so a resize during the query marks it stale again
+
+    if (!query_terminal_size(&w, &h) && !probe_terminal_size(&w, &h)) {
+        seqdsize_stale = 1;
+        return;
+    }
+
+    seqdwidth = w;
+    seqdheight = h;
+    *width = w;
+    *height = h;
+}
+
+static inline bool terminal_resized(int* width, int* height) {
+    int w = 0, h = 0;
+    get_terminal_size(&w, &h);
+
+    if (w <= 0 || (w == seqdlast_width && h == seqdlast_height))
+        return false;
+
+    seqdlast_width = w;
+    seqdlast_height = h;
+    *width = w;
+    *height = h;
+    return true;
+}
+
+static inline bool probe_terminal_size(int* width, int* height) {
+    if (!seqdraw)                           // Only works in raw mode, this variable is defined 
+        return false;                       // later on next to the functions for setting raw
+
+    // Ask where the cursor ends up after moving it as far as it goes, then put it back
+    immediate("\0337" SEQD_SETCUR_C(999, 999) SEQD_CURPOS "\0338");
+
+    // The reply goes into seqdin with any keys typed meanwhile, which stay there for keypress/keypress_ex
+    int row = 0, col = 0;
+    for (int waited = 0; waited <= SEQD_PROBE_TIMEOUT; waited += 10) {
+        if (take_cursor_report(&row, &col)) {
+            *width = col;
+            *height = row;
+            return true;
+        }
+
+        if (seqdin_end >= SEQD_INPUT_BUFFER_SIZE && seqdin_start == 0)
+            return false;                   // Full of keys, there's no room for the reply
+
+        fill_input(10);
+    }
+
+    return false;
+}
+
+///////////////////////// Platform specific functions ///////////////////////// 
+// These are a little harder to read. Dependencies and any globals are       //
+// included at the top of this section. Globals are prefixed with seqd_.     //
+//                                                                           //
+// There's a comment with whitespace to indicate what each sub-section is    //
+// responsible for.                                                          //
+///////////////////////////////////////////////////////////////////////////////
+
+// Output (file descriptors)
+
+static inline void set_output_fd(int fd) {
+    seqdout = fd;
+}
+
+static inline void set_frame_mode(unsigned int flags) {
+    seqdframe = flags;
+}
+
+#ifndef _WIN32
+static inline bool wait_writable(int fd) {                             // Blocks until a non-blocking fd can take more output
+    struct pollfd fds;
+    fds.fd = fd;
+    fds.events = POLLOUT;
+
+    while (poll(&fds, 1, -1) < 0)
+        if (errno != EINTR)
+            return false;
+
+    return true;
+}
+#endif
+
+static inline bool write_all(int fd, const char* data, size_t size) {
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        while (size > 0) {
+            int n = _write(fd, data, size > 0x7FFFFFFF ? 0x7FFFFFFF : (unsigned int) size);
+            SEQD_STAT(seqdwrite_calls++);
+            if (n < 0)
+                return false;
+
+            data += n;
+            size -= n;
+        }
+
+        return true;
+
+    #else                           // POSIX implementation
+
+        while (size > 0) {
+            ssize_t n = write(fd, data, size);
+            SEQD_STAT(seqdwrite_calls++);
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable(fd))
+                    continue;
+                return false;
+            }
+
+            data += n;              // Partial write, carry on from where it stopped
+            size -= n;
+        }
+
+        return true;
+
+    #endif
+
+}
+
+static inline bool write_segments(int fd, const seqd_segment* segments, int count) {
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        for (int i = 0; i < count; i++)
+            if (!write_all(fd, segments[i].data, segments[i].size))
+                return false;
+
+        return true;
+
+    #else                           // POSIX implementation
+
+        while (count > 0) {
+            struct iovec iov[SEQD_WRITEV_BATCH];
+            int n = count < SEQD_WRITEV_BATCH ? count : SEQD_WRITEV_BATCH;
+
+            for (int i = 0; i < n; i++) {
+                iov[i].iov_base = (void*) segments[i].data;
+                iov[i].iov_len = segments[i].size;
+            }
+
+            int first = 0;          // First segment that hasn't been fully written
+            while (first < n) {
+                ssize_t written = writev(fd, iov + first, n - first);
+                SEQD_STAT(seqdwrite_calls++);
+
+                if (written < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable(fd))
+                        continue;
+                    return false;
+                }
+
+                while (first < n && (size_t) written >= iov[first].iov_len) {
+                    written -= iov[first].iov_len;
+                    first++;
+                }
+
+                if (first < n) {    // Partial write, the rest of this segment goes next
+                    iov[first].iov_base = (char*) iov[first].iov_base + written;
+                    iov[first].iov_len -= written;
+                }
+            }
+
+            segments += n;
+            count -= n;
+        }
+
+        return true;
+
+    #endif
+
+}
+
+
+
+// Instrumentation
+
+static inline unsigned long long seqd_clock_ns() {
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        LARGE_INTEGER count, frequency;
+        QueryPerformanceCounter(&count);
+        QueryPerformanceFrequency(&frequency);
+        return (unsigned long long) (count.QuadPart / frequency.QuadPart * 1000000000ull
+            + count.QuadPart % frequency.QuadPart * 1000000000ull / frequency.QuadPart);
+
+    #else                           // POSIX implementation
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (unsigned long long) ts.tv_sec * 1000000000ull + (unsigned long long) ts.tv_nsec;
+
+    #endif
+
+}
+
+static inline void seqd_reset_stats(seqd_context* ctx) {
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+}
+
+static inline seqd_stats get_stats()                                    { return seqdctx.stats; }
+static inline void reset_stats()                                        { seqd_reset_stats(&seqdctx); }
+
+
+
+// Terminal size
+
+static inline bool query_terminal_size(int* width, int* height) {      // Asks the OS, no terminal round trip
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+            return false;
+
+        *width = info.srWindow.Right - info.srWindow.Left + 1;
+        *height = info.srWindow.Bottom - info.srWindow.Top + 1;
+        return true;
+
+    #else                           // POSIX implementation
+
+        struct winsize ws;
+        if ((ioctl(seqdout, TIOCGWINSZ, &ws) < 0 && ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) < 0) || ws.ws_col == 0)
+            return false;
+
+        *width = ws.ws_col;
+        *height = ws.ws_row;
+        return true;
+
+    #endif
+
+}
+
+#ifndef _WIN32
+static inline void seqd_winch_handler(int sig) {
+    (void) sig;
+    int saved = errno;
+    char c = 0;
+
+    seqdsize_stale = 1;
+    if (seqdwinch[1] >= 0 && write(seqdwinch[1], &c, 1) < 0) {}         // A full pipe already means a resize is pending
+    errno = saved;
+}
+#endif
+
+static inline bool watch_terminal_size() {
+
+    #ifdef _WIN32                   // WINDOWS implementation, there is no resize signal so the size is never cached
+
+        return false;
+
+    #else                           // POSIX implementation
+
+        if (seqdsize_watched)
+            return true;
+
+        struct sigaction sa;
+        if (sigaction(SIGWINCH, NULL, &sa) < 0 || (sa.sa_handler != SIG_DFL && sa.sa_handler != SIG_IGN))
+            return false;                   // Somebody else handles resizes, so the cache couldn't be trusted
+
+        if (pipe(seqdwinch) < 0)
+            return false;
+
+        for (int i = 0; i < 2; i++) {
+            fcntl(seqdwinch[i], F_SETFL, fcntl(seqdwinch[i], F_GETFL) | O_NONBLOCK);
+            fcntl(seqdwinch[i], F_SETFD, FD_CLOEXEC);
+        }
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = seqd_winch_handler;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+
+        if (sigaction(SIGWINCH, &sa, NULL) < 0) {
+            close(seqdwinch[0]);
+            close(seqdwinch[1]);
+            seqdwinch[0] = seqdwinch[1] = -1;
+            return false;
+        }
+
+        seqdsize_stale = 1;
+        seqdsize_watched = true;
+        return true;
+
+    #endif
+
+}
+
+
+
+// Raw mode
+ 
+static inline void set_raw_mode() {
+
+    #ifdef _WIN32                           // WINDOWS implementation
+                
+            // Disable input buffering and character echo
+            HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
+
+            // Get current console input mode
+            if (!GetConsoleMode(hstdin, &seqdmode)) {
+                perror("GetConsoleMode");
+                exit(EXIT_FAILURE);
+            }
+
+            // Disable line input and echo
+            DWORD new_mode = seqdmode & ~(ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT);
+            if (!SetConsoleMode(hstdin, new_mode)) {
+                perror("SetConsoleMode");
+                exit(EXIT_FAILURE);
+            }
+
+    #else                                       // POSIX implementation
+
+            // Get the current terminal settings
+            //struct termios term = { 0 };
+            fflush(stdout);
+
+            if (tcgetattr(STDIN_FILENO, &seqdterm) < 0)
+                perror("tcgetattr");
+
+            // Save the original terminal settings for later restoration
+            //seqdterm = term;
+            struct termios term = seqdterm;
+
+            // Set the terminal to raw mode
+            term.c_lflag &= ~(ICANON | ECHO);  // Disable canonical mode and echo
+            term.c_cc[VMIN] = 1;               // Minimum number of bytes for non-canonical mode
+            term.c_cc[VTIME] = 0;              // Timeout for non-canonical mode
+
+            if (tcsetattr(STDIN_FILENO, TCSANOW, &term) < 0)
+                perror("tcsetattr");
+
+    #endif
+    
+    seqdraw = true;
+}
+
+
+static inline void unset_raw_mode() {
+
+    #ifdef _WIN32
+
+        HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
+
+        if (!SetConsoleMode(hstdin, seqdmode)) {
+            perror("SetConsoleMode");
+            exit(EXIT_FAILURE);
+        }
+
+    #else       // POSIX implementation
+
+        if (tcsetattr(STDIN_FILENO, TCSANOW, &seqdterm) < 0)
+            perror("tcsetattr");
+
+    #endif
+
+    seqdraw = false;
+
+}
+
+
+
+// Input (non-blocking)
+
+static inline char keypress() {
+
+    if (seqdin_start < seqdin_end)  // Left over from keypress_ex
+        return seqdin[seqdin_start++];
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        if (_kbhit())
+            return _getch();
+        return 0;
+
+    #else                           // POSIX implementation
+        // Non-blocking read only works in raw mode, for blocking reads there is a separate function
+        if (!seqdraw)
+            return 0;
+
+        // Check if there is char in stdin
+        if (feof(stdin) != 0) {
+            clearerr(stdin);
+            return 0;
+        }
+
+        // Read char from stdin
+        struct pollfd fds;
+        fds.fd = STDIN_FILENO; 
+        fds.events = POLLIN;
+
+        if (poll(&fds, 1, SEQD_KEYBOARD_TIMEOUT)) {
+            char c;
+            ssize_t n = read(STDIN_FILENO, &c, 1);
+
+            if (n == 1)
+                return (char) c;
+        }
+
+        return 0;
+
+    #endif
+
+}
+
+static inline bool fill_input(int timeout) {                           // *Waits up to timeout ms for keyboard input, then reads everything available into seqdin
+
+    if (seqdin_start > 0) {         // Move what's left to the front to make room
+        memmove(seqdin, seqdin + seqdin_start, seqdin_end - seqdin_start);
+        seqdin_end -= seqdin_start;
+        seqdin_start = 0;
+    }
+
+    if (seqdin_end >= SEQD_INPUT_BUFFER_SIZE)
+        return true;
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        DWORD start = GetTickCount();
+        while (!_kbhit()) {
+            if (timeout >= 0 && GetTickCount() - start >= (DWORD) timeout)
+                return false;
+            Sleep(1);
+        }
+
+        while (_kbhit() && seqdin_end < SEQD_INPUT_BUFFER_SIZE)
+            seqdin[seqdin_end++] = (char) _getch();
+
+        return true;
+
+    #else                           // POSIX implementation
+
+        struct pollfd fds;
+        fds.fd = STDIN_FILENO;
+        fds.events = POLLIN;
+
+        // A signal (SIGWINCH on every resize) cuts poll short, so wait again for whatever is left
+        unsigned long long end = seqd_clock_ns() + (unsigned long long) (timeout > 0 ? timeout : 0) * 1000000ull;
+        int ready;
+
+        while ((ready = poll(&fds, 1, timeout)) < 0 && errno == EINTR) {
+            if (timeout > 0) {
+                unsigned long long now = seqd_clock_ns();
+                timeout = now >= end ? 0 : (int) ((end - now + 999999) / 1000000);
+            }
+        }
+
+        if (ready < 0)
+            seqdin_eof = true;
+        if (ready <= 0)
+            return false;
+
+        int n = read_stdin(seqdin + seqdin_end, SEQD_INPUT_BUFFER_SIZE - seqdin_end);
+        if (n <= 0) {
+            seqdin_eof = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            return false;
+        }
+
+        seqdin_eof = false;
+        seqdin_end += n;
+        return true;
+
+    #endif
+
+}
+
+static inline seqd_key keypress_ex(int timeout) {
+    seqd_key key = { 0, 0 };
+
+    #ifndef _WIN32
+        if (!seqdraw)               // Like keypress, this only works in raw mode
+            return key;
+    #endif
+
+    if (seqdin_start == seqdin_end && !fill_input(timeout))
+        return key;
+
+    #ifdef _WIN32
+        unsigned char first = (unsigned char) seqdin[seqdin_start];    // fill_input moves the bytes but keeps their order
+    #endif
+
+    while (true) {
+        int used = decode_key(seqdin + seqdin_start, seqdin_end - seqdin_start, false, &key);
+
+        if (used == 0 && seqdin_end - seqdin_start < SEQD_INPUT_BUFFER_SIZE && fill_input(SEQD_ESC_TIMEOUT))
+            continue;               // The rest of the sequence arrived
+
+        if (used == 0)              // Nothing else came, so take the bytes for what they are
+            used = decode_key(seqdin + seqdin_start, seqdin_end - seqdin_start, true, &key);
+
+        seqdin_start += used;
+        break;
+    }
+
+    #ifdef _WIN32                   // WINDOWS arrows and friends arrive as 0 or 0xE0 and a scan code
+        if ((first == 0 || (first == 0xE0 && key.code == 0xFFFD)) && seqdin_start < seqdin_end) {
+            key.mods = 0;
+            switch (seqdin[seqdin_start++]) {
+                case 72: key.code = SEQD_KEYCODE_UP;        break;
+                case 80: key.code = SEQD_KEYCODE_DOWN;      break;
+                case 77: key.code = SEQD_KEYCODE_RIGHT;     break;
+                case 75: key.code = SEQD_KEYCODE_LEFT;      break;
+                case 82: key.code = SEQD_KEYCODE_INSERT;    break;
+                case 83: key.code = SEQD_KEYCODE_DELETE;    break;
+                case 71: key.code = SEQD_KEYCODE_HOME;      break;
+                case 79: key.code = SEQD_KEYCODE_END;       break;
+                case 73: key.code = SEQD_KEYCODE_PAGE_UP;   break;
+                case 81: key.code = SEQD_KEYCODE_PAGE_DOWN; break;
+                default: key.code = SEQD_KEYCODE_UNKNOWN;   break;
+            }
+        }
     #endif
 
+    return key;
 }
 
 /////////////////////////////////////////////////////////////////////////////// 
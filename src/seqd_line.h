@@ -0,0 +1,540 @@
+// Seqd line - header-only extension to seqd.h
+// A one line editor for raw mode prompts, with cursor movement, insert and
+// delete, a history ring and Tab completion. Every key only redraws the part
+// of the line that changed, instead of printing the whole line again.
+
+#ifndef SEQD_LINE_H
+#define SEQD_LINE_H
+
+///////////////////////////////// Dependencies ////////////////////////////////
+#include "seqd.h"
+
+///////////////////////// Preprocessor config options /////////////////////////
+
+#ifndef SEQD_LINE_HISTORY
+#define SEQD_LINE_HISTORY 64                                            // Lines kept in each editor's history ring, the oldest is dropped first
+#endif
+
+///////////////////////////////////// Docs ////////////////////////////////////
+// seqd_line_read is a blocking prompt that works like get_input. To use the //
+// editor from an event loop (see seqd_loop.h), call seqd_line_begin, then   //
+// pass every key to seqd_line_feed until it stops returning                 //
+// SEQD_LINE_EDITING.                                                        //
+//                                                                           //
+// The prompt must fit on one row. Columns are counted with char_width,      //
+// so wide characters take two and combining marks none. A line wider than   //
+// the terminal scrolls sideways so the cursor stays on screen.              //
+//                                                                           //
+// Keys: Left/Right (Ctrl+B/F), Home/End (Ctrl+A/E), Alt+B/F by word,        //
+// Backspace, Delete, Ctrl+K/U kill to end/start, Ctrl+W kill word,          //
+// Up/Down (Ctrl+P/N) history, Tab completion, Enter. Ctrl+C, or Ctrl+D on   //
+// an empty line, cancels.                                                   //
+//                                                                           //
+// Raw mode leaves Ctrl+C as SIGINT, so seqd_line_read turns that off while  //
+// it runs and puts it back after. Programs using seqd_line_feed only get    //
+// Ctrl+C as a key if they have turned it off themselves.                    //
+///////////////////////////////////////////////////////////////////////////////
+
+// Constants
+#define SEQD_LINE_EDITING   0                                           // seqd_line_feed results
+#define SEQD_LINE_DONE      1
+#define SEQD_LINE_CANCELLED 2
+
+// Types
+typedef struct seqd_line seqd_line;
+typedef void (*seqd_complete_fn)(seqd_line* l, void* user);             // Called on Tab, changes the line with seqd_line_insert/seqd_line_set - the editor redraws afterwards
+
+struct seqd_line {
+    const char* prompt;
+    int prompt_width;                                                   // Columns the prompt takes
+    unsigned int* text;                                                 // The line being edited, as codepoints
+    int length;
+    int capacity;
+    int cursor;                                                         // Index into text, length when at the end
+    int offset;                                                         // Index of the first codepoint on screen, above 0 when the line is wider than the terminal
+
+    unsigned int* shown;                                                // What the terminal shows after the prompt
+    int shown_length;
+    int shown_capacity;
+    int shown_column;                                                   // Where the terminal cursor is, 0 being the first column after the prompt
+
+    char* history[SEQD_LINE_HISTORY];                                   // Ring of past lines, NULL where unused
+    int history_count;
+    int history_next;                                                   // Slot the next line goes into
+    int history_index;                                                  // 0 while editing a new line, n while showing the nth newest
+    char* draft;                                                        // The new line, kept while browsing the history
+
+    seqd_complete_fn complete;
+    void* complete_user;
+
+    char* utf8;                                                         // What seqd_line_text returns
+    int utf8_capacity;
+    seqd_context* ctx;                                                  // Where redraws are queued, seqdctx unless set otherwise
+};
+
+// Setup
+static inline void seqd_line_init(seqd_line* l, const char* prompt);    // Empty editor with no history, prompt is not copied
+static inline void seqd_line_free(seqd_line* l);                        // Frees the line and the history
+static inline void seqd_line_on_complete(seqd_line* l, seqd_complete_fn fn, void* user); // Sets the Tab completion callback, NULL turns it off
+static inline void seqd_line_history_add(seqd_line* l, const char* utf8); // Adds a line to the history, empty lines and repeats of the newest are skipped
+
+// Editing
+static inline const char* seqd_line_read(seqd_line* l);                 // *Prompts and edits until Enter, returns the line (valid until the next call) or NULL when cancelled - turns raw mode on if it's off and Ctrl+C signals off
+static inline void seqd_line_begin(seqd_line* l);                       // Empties the line and prints the prompt at the start of the current row
+static inline int seqd_line_feed(seqd_line* l, seqd_key key);           // Applies one key and redraws, returns a SEQD_LINE_ result
+static inline void seqd_line_refresh(seqd_line* l);                     // Redraws what changed and displays it, feed does this after every key
+
+// Text
+static inline const char* seqd_line_text(seqd_line* l);                 // The line as UTF-8, valid until the line changes
+static inline bool seqd_line_insert(seqd_line* l, const char* utf8);    // Inserts at the cursor and moves it past the text, false on failure
+static inline bool seqd_line_set(seqd_line* l, const char* utf8);       // Replaces the line, the cursor goes to the end
+static inline int seqd_line_word_start(const seqd_line* l);             // Index where the word before the cursor starts, for completion
+
+////////////////////////////// Utility functions //////////////////////////////
+
+static inline bool seqd_line_grow(unsigned int** array, int* capacity, int needed) {
+    if (needed <= *capacity)
+        return true;
+
+    int capacity_new = *capacity ? *capacity : 64;
+    while (capacity_new < needed)
+        capacity_new *= 2;
+
+    unsigned int* grown = (unsigned int*) realloc(*array, capacity_new * sizeof(unsigned int));
+    if (grown == NULL)
+        return false;
+
+    *array = grown;
+    *capacity = capacity_new;
+    return true;
+}
+
+static inline char* seqd_line_copy(const char* utf8) {
+    size_t size = strlen(utf8) + 1;
+    char* copy = (char*) malloc(size);
+
+    if (copy != NULL)
+        memcpy(copy, utf8, size);
+
+    return copy;
+}
+
+static inline const char* seqd_line_history_entry(const seqd_line* l, int n) { // The nth newest line, 1 being the newest
+    return l->history[(l->history_next - n + SEQD_LINE_HISTORY) % SEQD_LINE_HISTORY];
+}
+
+static inline bool seqd_line_is_word(unsigned int ch) {
+    return ch != ' ' && ch != '\t';
+}
+
+static inline int seqd_line_columns(const unsigned int* text, int count) { // Columns count codepoints take on screen
+    int columns = 0;
+    for (int i = 0; i < count; i++)
+        columns += char_width(text[i]);
+
+    return columns;
+}
+
+static inline void seqd_line_move(seqd_line* l, int column) {           // Puts the terminal cursor on a column after the prompt
+    if (l->shown_column == column)
+        return;
+
+    seqd_csi(l->ctx, l->prompt_width + column + 1, 'G');                // SEQD_CUR_HORIZONTAL, which is 1 based
+    l->shown_column = column;
+}
+
+static inline void seqd_line_delete(seqd_line* l, int from, int to) {   // Removes text[from, to) and fixes up the cursor
+    memmove(l->text + from, l->text + to, (l->length - to) * sizeof(unsigned int));
+    l->length -= to - from;
+
+    if (l->cursor >= to)
+        l->cursor -= to - from;
+    else if (l->cursor > from)
+        l->cursor = from;
+}
+
+////////////////////////// Platform specific functions ////////////////////////
+
+static inline bool seqd_line_signals(bool on) {                         // Turns Ctrl+C as a signal on or off, returns whether it was on
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
+        DWORD mode;
+        if (!GetConsoleMode(hstdin, &mode))
+            return on;
+
+        SetConsoleMode(hstdin, on ? mode | ENABLE_PROCESSED_INPUT : mode & ~ENABLE_PROCESSED_INPUT);
+        return (mode & ENABLE_PROCESSED_INPUT) != 0;
+
+    #else                           // POSIX implementation
+
+        struct termios term;
+        if (tcgetattr(STDIN_FILENO, &term) < 0)
+            return on;
+
+        bool was_on = (term.c_lflag & ISIG) != 0;
+        if (on)
+            term.c_lflag |= ISIG;
+        else
+            term.c_lflag &= ~ISIG;
+
+        tcsetattr(STDIN_FILENO, TCSANOW, &term);
+        return was_on;
+
+    #endif
+}
+
+///////////////////////////////////// Setup ///////////////////////////////////
+
+static inline void seqd_line_init(seqd_line* l, const char* prompt) {
+    memset(l, 0, sizeof(*l));
+    l->ctx = &seqdctx;
+    l->prompt = prompt ? prompt : "";
+
+    for (const char* p = l->prompt; *p != '\0'; )
+        l->prompt_width += char_width(seqd_utf8_decode(&p));
+}
+
+static inline void seqd_line_free(seqd_line* l) {
+    for (int i = 0; i < SEQD_LINE_HISTORY; i++)
+        free(l->history[i]);
+
+    free(l->text);
+    free(l->shown);
+    free(l->draft);
+    free(l->utf8);
+    memset(l, 0, sizeof(*l));
+}
+
+static inline void seqd_line_on_complete(seqd_line* l, seqd_complete_fn fn, void* user) {
+    l->complete = fn;
+    l->complete_user = user;
+}
+
+static inline void seqd_line_history_add(seqd_line* l, const char* utf8) {
+    if (utf8[0] == '\0')
+        return;
+
+    if (l->history_count > 0 && strcmp(seqd_line_history_entry(l, 1), utf8) == 0)
+        return;
+
+    char* copy = seqd_line_copy(utf8);
+    if (copy == NULL)
+        return;
+
+    free(l->history[l->history_next]);                                  // Drops the oldest once the ring is full
+    l->history[l->history_next] = copy;
+    l->history_next = (l->history_next + 1) % SEQD_LINE_HISTORY;
+
+    if (l->history_count < SEQD_LINE_HISTORY)
+        l->history_count++;
+}
+
+///////////////////////////////////// Text ////////////////////////////////////
+
+static inline const char* seqd_line_text(seqd_line* l) {
+    int needed = l->length * 4 + 1;
+
+    if (needed > l->utf8_capacity) {
+        char* grown = (char*) realloc(l->utf8, needed);
+        if (grown == NULL)
+            return "";
+
+        l->utf8 = grown;
+        l->utf8_capacity = needed;
+    }
+
+    char* out = l->utf8;
+    for (int i = 0; i < l->length; i++)
+        out += seqd_utf8_encode(l->text[i], out);
+
+    *out = '\0';
+    return l->utf8;
+}
+
+static inline bool seqd_line_insert(seqd_line* l, const char* utf8) {
+    int count = 0;
+    for (const char* p = utf8; *p != '\0'; count++)
+        seqd_utf8_decode(&p);
+
+    if (!seqd_line_grow(&l->text, &l->capacity, l->length + count))
+        return false;
+
+    memmove(l->text + l->cursor + count, l->text + l->cursor, (l->length - l->cursor) * sizeof(unsigned int));
+
+    for (int i = 0; i < count; i++)
+        l->text[l->cursor + i] = seqd_utf8_decode(&utf8);
+
+    l->length += count;
+    l->cursor += count;
+    return true;
+}
+
+static inline bool seqd_line_set(seqd_line* l, const char* utf8) {
+    l->length = 0;
+    l->cursor = 0;
+    return seqd_line_insert(l, utf8);
+}
+
+static inline int seqd_line_word_start(const seqd_line* l) {
+    int i = l->cursor;
+
+    while (i > 0 && seqd_line_is_word(l->text[i - 1]))
+        i--;
+
+    return i;
+}
+
+///////////////////////////////////// Output //////////////////////////////////
+
+static inline void seqd_line_refresh(seqd_line* l) {
+    int width = 0, height = 0;
+    get_terminal_size(&width, &height);
+
+    // The last column is left empty, so the terminal never wraps onto the next row
+    int visible = width - l->prompt_width - 1;
+    if (visible < 1)
+        visible = 1;
+
+    // Scroll back when the text got shorter, then forward just far enough that the cursor has a column on screen
+    if (l->offset > l->cursor)
+        l->offset = l->cursor;
+
+    int tail = seqd_line_columns(l->text + l->offset, l->length - l->offset);
+    while (l->offset > 0 && tail + char_width(l->text[l->offset - 1]) < visible)
+        tail += char_width(l->text[--l->offset]);
+
+    int under = l->cursor < l->length && char_width(l->text[l->cursor]) == 2 ? 2 : 1; // Room for what the cursor is on
+    int cursor_column = seqd_line_columns(l->text + l->offset, l->cursor - l->offset);
+    while (l->offset < l->cursor && cursor_column + under > visible)
+        cursor_column -= char_width(l->text[l->offset++]);
+
+    // As much of the line as fits, a wide character that would stick out is left off
+    const unsigned int* want = l->text + l->offset;
+    int count = 0, columns = 0;
+    while (count < l->length - l->offset && columns + char_width(want[count]) <= visible)
+        columns += char_width(want[count++]);
+
+    // Only the tail that differs from what's on screen is written again
+    int same = 0;
+    while (same < count && same < l->shown_length && want[same] == l->shown[same])
+        same++;
+
+    if (same < count) {
+        char utf8[4];
+        seqd_line_move(l, seqd_line_columns(want, same));
+
+        for (int i = same; i < count; i++)
+            seqd_buffer_n(l->ctx, utf8, seqd_utf8_encode(want[i], utf8));
+
+        l->shown_column = columns;
+    }
+
+    if (columns < seqd_line_columns(l->shown, l->shown_length)) {
+        seqd_line_move(l, columns);
+        seqd_csi(l->ctx, 0, 'K');                                       // SEQD_ERASE_LINE(0), clears the old tail
+    }
+
+    if (same < count || count != l->shown_length) {
+        if (seqd_line_grow(&l->shown, &l->shown_capacity, count)) {
+            memcpy(l->shown + same, want + same, (count - same) * sizeof(unsigned int));
+            l->shown_length = count;
+        } else {
+            l->shown_length = 0;                                        // Forget what's shown, the next refresh writes it all
+        }
+    }
+
+    seqd_line_move(l, cursor_column);
+
+    seqd_display(l->ctx);
+    seqd_clear(l->ctx);
+}
+
+//////////////////////////////////// Editing //////////////////////////////////
+
+static inline void seqd_line_begin(seqd_line* l) {
+    l->length = 0;
+    l->cursor = 0;
+    l->offset = 0;
+    l->shown_length = 0;
+    l->shown_column = 0;
+    l->history_index = 0;
+
+    seqd_buffer(l->ctx, "\r");
+    seqd_buffer(l->ctx, l->prompt);
+    seqd_csi(l->ctx, 0, 'K');                                           // Whatever was on the row after the prompt
+
+    seqd_display(l->ctx);
+    seqd_clear(l->ctx);
+}
+
+static inline void seqd_line_history_show(seqd_line* l, int index) {    // Moves through the history, index 0 is the new line
+    if (index < 0 || index > l->history_count || index == l->history_index)
+        return;
+
+    if (l->history_index == 0) {                                        // Leaving the new line, keep it for coming back
+        free(l->draft);
+        l->draft = seqd_line_copy(seqd_line_text(l));
+    }
+
+    l->history_index = index;
+    seqd_line_set(l, index == 0 ? (l->draft ? l->draft : "") : seqd_line_history_entry(l, index));
+}
+
+static inline int seqd_line_feed(seqd_line* l, seqd_key key) {
+    int code = key.code;
+
+    if (key.mods & SEQD_MOD_ALT) {                                      // Only the word moves use Alt
+        if (code == 'b' || code == 'B') {
+            while (l->cursor > 0 && !seqd_line_is_word(l->text[l->cursor - 1]))
+                l->cursor--;
+            l->cursor = seqd_line_word_start(l);
+        } else if (code == 'f' || code == 'F') {
+            while (l->cursor < l->length && !seqd_line_is_word(l->text[l->cursor]))
+                l->cursor++;
+            while (l->cursor < l->length && seqd_line_is_word(l->text[l->cursor]))
+                l->cursor++;
+        }
+
+        seqd_line_refresh(l);
+        return SEQD_LINE_EDITING;
+    }
+
+    switch (code) {
+        case '\r':
+        case '\n':
+            l->cursor = l->length;
+            seqd_line_refresh(l);
+
+            seqd_buffer(l->ctx, "\r\n");
+            seqd_display(l->ctx);
+            seqd_clear(l->ctx);
+            return SEQD_LINE_DONE;
+
+        case SEQD_KEY_CTRL_PLUS_('d'):
+            if (l->length > 0) {
+                if (l->cursor < l->length)
+                    seqd_line_delete(l, l->cursor, l->cursor + 1);
+                break;
+            }
+            // An empty line cancels, like EOF in a shell
+            // fall through
+        case SEQD_KEY_CTRL_PLUS_('c'):
+            seqd_buffer(l->ctx, "\r\n");
+            seqd_display(l->ctx);
+            seqd_clear(l->ctx);
+            return SEQD_LINE_CANCELLED;
+
+        case SEQD_KEY_BACKSPACE:
+        case '\b':
+            if (l->cursor > 0)
+                seqd_line_delete(l, l->cursor - 1, l->cursor);
+            break;
+
+        case SEQD_KEYCODE_DELETE:
+            if (l->cursor < l->length)
+                seqd_line_delete(l, l->cursor, l->cursor + 1);
+            break;
+
+        case SEQD_KEYCODE_LEFT:
+        case SEQD_KEY_CTRL_PLUS_('b'):
+            if (l->cursor > 0)
+                l->cursor--;
+            break;
+
+        case SEQD_KEYCODE_RIGHT:
+        case SEQD_KEY_CTRL_PLUS_('f'):
+            if (l->cursor < l->length)
+                l->cursor++;
+            break;
+
+        case SEQD_KEYCODE_HOME:
+        case SEQD_KEY_CTRL_PLUS_('a'):
+            l->cursor = 0;
+            break;
+
+        case SEQD_KEYCODE_END:
+        case SEQD_KEY_CTRL_PLUS_('e'):
+            l->cursor = l->length;
+            break;
+
+        case SEQD_KEY_CTRL_PLUS_('k'):
+            seqd_line_delete(l, l->cursor, l->length);
+            break;
+
+        case SEQD_KEY_CTRL_PLUS_('u'):
+            seqd_line_delete(l, 0, l->cursor);
+            break;
+
+        case SEQD_KEY_CTRL_PLUS_('w'): {
+            int end = l->cursor;
+            while (l->cursor > 0 && !seqd_line_is_word(l->text[l->cursor - 1]))
+                l->cursor--;
+            seqd_line_delete(l, seqd_line_word_start(l), end);
+            break;
+        }
+
+        case SEQD_KEYCODE_UP:
+        case SEQD_KEY_CTRL_PLUS_('p'):
+            seqd_line_history_show(l, l->history_index + 1);
+            break;
+
+        case SEQD_KEYCODE_DOWN:
+        case SEQD_KEY_CTRL_PLUS_('n'):
+            seqd_line_history_show(l, l->history_index - 1);
+            break;
+
+        case SEQD_KEY_TAB:
+            if (l->complete != NULL && !(key.mods & SEQD_MOD_SHIFT))
+                l->complete(l, l->complete_user);
+            break;
+
+        default:
+            if (code >= ' ' && code != SEQD_KEY_BACKSPACE && code < 0x110000) { // Text, not a SEQD_KEYCODE_ or control character
+                char utf8[5];
+                utf8[seqd_utf8_encode((unsigned int) code, utf8)] = '\0';
+                seqd_line_insert(l, utf8);
+            }
+            break;
+    }
+
+    seqd_line_refresh(l);
+    return SEQD_LINE_EDITING;
+}
+
+static inline const char* seqd_line_read(seqd_line* l) {
+    bool was_raw = seqdraw;
+    if (!was_raw)
+        set_raw_mode();
+
+    bool signals = seqd_line_signals(false);                            // Ctrl+C comes in as a key and cancels the line
+    seqd_line_begin(l);
+
+    int state = SEQD_LINE_EDITING;
+    while (state == SEQD_LINE_EDITING) {
+        seqd_key key = keypress_ex(-1);
+
+        if (key.code == 0 && seqdin_eof) {                              // stdin was closed or broke, nothing more is coming
+            state = SEQD_LINE_CANCELLED;
+            break;
+        }
+
+        if (key.code == 0)
+            continue;
+
+        state = seqd_line_feed(l, key);
+    }
+
+    seqd_line_signals(signals);
+    if (!was_raw)
+        unset_raw_mode();
+
+    if (state != SEQD_LINE_DONE)
+        return NULL;
+
+    const char* text = seqd_line_text(l);
+    seqd_line_history_add(l, text);
+    return text;
+}
+
+#endif
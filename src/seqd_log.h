@@ -0,0 +1,253 @@
+// Seqd log - header-only extension to seqd.h
+// A tail view for fast moving logs. New lines are kept in a bounded ring of
+// history, and a render shifts what is already on screen with a scroll region
+// (DECSTBM) and SEQD_SCROLL_UP/DOWN, so only the lines that came into view are
+// written.
+
+#ifndef SEQD_LOG_H
+#define SEQD_LOG_H
+
+///////////////////////////////// Dependencies ////////////////////////////////
+#include "seqd.h"
+
+///////////////////////// Preprocessor config options /////////////////////////
+
+#ifndef SEQD_LOG_HISTORY
+#define SEQD_LOG_HISTORY 10000                                          // Lines kept for scrollback when seqd_log_init isn't given a count
+#endif
+
+///////////////////////////////////// Docs ////////////////////////////////////
+// The pane covers whole rows of the terminal, because scroll regions can't  //
+// be narrower than the screen. Rows are 0 based, like seqd_screen.h.        //
+//                                                                           //
+// seqd_log_append only stores lines. Call seqd_log_render (or present) once //
+// per frame: however many lines came in since the last one, at most one     //
+// screenful is written, so bursts cost no more than a full repaint.         //
+//                                                                           //
+// Lines are written as they are and clipped with text_fit, so control       //
+// characters (tabs, escape sequences) should be taken out before appending. //
+// A render leaves the cursor at an unknown position.                        //
+///////////////////////////////////////////////////////////////////////////////
+
+// Types
+typedef struct seqd_log_line {
+    char* text;                                                         // Reused for whichever line lands in this slot next
+    unsigned int length;
+    unsigned int capacity;
+} seqd_log_line;
+
+typedef struct seqd_log {
+    int top;                                                            // First row of the pane
+    int height;
+    int width;
+
+    seqd_log_line* lines;                                               // Ring, line n lives in slot n % history
+    int history;
+    unsigned long long total;                                           // Lines ever appended
+
+    int scroll;                                                         // Lines back from the newest, 0 follows the tail
+    unsigned long long shown_end;                                       // One past the last line on screen after the last render
+    bool full_redraw;
+
+    seqd_attr attr;
+    seqd_context* ctx;                                                  // Where renders are queued, seqdctx unless set otherwise
+} seqd_log;
+
+// Setup
+static inline bool seqd_log_init(seqd_log* log, int top, int height, int history); // Pane over rows top to top + height - 1, history <= 0 uses SEQD_LOG_HISTORY - false on failure
+static inline void seqd_log_free(seqd_log* log);
+static inline void seqd_log_resize(seqd_log* log, int top, int height); // Moves the pane and takes the width from get_terminal_size, the next render repaints it
+
+// Lines
+static inline void seqd_log_append(seqd_log* log, const char* text);    // Stores text, one line per '\n'
+static inline void seqd_log_append_n(seqd_log* log, const char* line, unsigned int length); // Stores one line of length bytes, without its '\n'
+static inline void seqd_log_clear(seqd_log* log);                       // Drops the history and blanks the pane
+
+// Scrollback
+static inline void seqd_log_scroll(seqd_log* log, int lines);           // Moves back into the history by lines, negative goes towards the newest
+static inline void seqd_log_follow(seqd_log* log);                      // Back to following the newest lines
+
+// Output
+static inline void seqd_log_render(seqd_log* log);                      // Queues whatever changed since the last render into log->ctx
+static inline void seqd_log_present(seqd_log* log);                     // seqd_log_render, then displays and clears log->ctx
+
+////////////////////////////// Utility functions //////////////////////////////
+
+static inline unsigned long long seqd_log_oldest(const seqd_log* log) { // First line still in the ring
+    return log->total > (unsigned long long) log->history ? log->total - log->history : 0;
+}
+
+static inline int seqd_log_max_scroll(const seqd_log* log) {
+    unsigned long long kept = log->total - seqd_log_oldest(log);
+    return kept > (unsigned long long) log->height ? (int) (kept - log->height) : 0;
+}
+
+static inline void seqd_log_draw(seqd_log* log, int row, unsigned long long n) { // Writes line n over a row of the pane, blank when n isn't in the ring
+    seqd_setcur(log->ctx, log->top + row + 1, 1);
+
+    if (n < seqd_log_oldest(log) || n >= log->total) {
+        seqd_text(log->ctx, "", 0, log->width);
+        return;
+    }
+
+    seqd_log_line* line = &log->lines[n % log->history];
+    seqd_text(log->ctx, line->text, line->length, log->width);
+}
+
+///////////////////////////////////// Setup ///////////////////////////////////
+
+static inline bool seqd_log_init(seqd_log* log, int top, int height, int history) {
+    memset(log, 0, sizeof(*log));
+
+    log->history = history > 0 ? history : SEQD_LOG_HISTORY;
+    log->lines = (seqd_log_line*) calloc(log->history, sizeof(seqd_log_line));
+    if (log->lines == NULL)
+        return false;
+
+    log->attr.fg = log->attr.bg = SEQD_COLOUR_DEFAULT;
+    log->ctx = &seqdctx;
+    seqd_log_resize(log, top, height);
+    return true;
+}
+
+static inline void seqd_log_free(seqd_log* log) {
+    for (int i = 0; log->lines != NULL && i < log->history; i++)
+        free(log->lines[i].text);
+
+    free(log->lines);
+    memset(log, 0, sizeof(*log));
+}
+
+static inline void seqd_log_resize(seqd_log* log, int top, int height) {
+    int width = 0, rows = 0;
+    get_terminal_size(&width, &rows);
+
+    log->top = top;
+    log->height = height > 0 ? height : 1;
+    log->width = width;
+    log->full_redraw = true;
+
+    if (log->scroll > seqd_log_max_scroll(log))
+        log->scroll = seqd_log_max_scroll(log);
+}
+
+///////////////////////////////////// Lines ///////////////////////////////////
+
+static inline void seqd_log_append_n(seqd_log* log, const char* line, unsigned int length) {
+    seqd_log_line* slot = &log->lines[log->total % log->history];
+
+    if (length + 1 > slot->capacity) {                                  // Slots keep their memory, so a steady stream stops allocating once the ring is full
+        unsigned int capacity = slot->capacity ? slot->capacity : 64;
+        while (capacity < length + 1)
+            capacity *= 2;
+
+        char* grown = (char*) realloc(slot->text, capacity);
+        if (grown == NULL)
+            return;
+
+        slot->text = grown;
+        slot->capacity = capacity;
+    }
+
+    memcpy(slot->text, line, length);
+    slot->text[length] = '\0';
+    slot->length = length;
+    log->total++;
+
+    if (log->scroll > 0 && log->scroll < seqd_log_max_scroll(log))      // Reading the history, keep the same lines in view
+        log->scroll++;
+}
+
+static inline void seqd_log_append(seqd_log* log, const char* text) {
+    while (true) {
+        const char* newline = strchr(text, '\n');
+
+        if (newline == NULL) {
+            if (*text != '\0')
+                seqd_log_append_n(log, text, (unsigned int) strlen(text));
+            return;
+        }
+
+        unsigned int length = (unsigned int) (newline - text);
+        if (length > 0 && text[length - 1] == '\r')
+            length--;
+
+        seqd_log_append_n(log, text, length);
+        text = newline + 1;
+    }
+}
+
+static inline void seqd_log_clear(seqd_log* log) {
+    log->total = 0;
+    log->scroll = 0;
+    log->full_redraw = true;
+}
+
+/////////////////////////////////// Scrollback ////////////////////////////////
+
+static inline void seqd_log_scroll(seqd_log* log, int lines) {
+    int scroll = log->scroll + lines;
+
+    if (scroll > seqd_log_max_scroll(log))
+        scroll = seqd_log_max_scroll(log);
+    if (scroll < 0)
+        scroll = 0;
+
+    log->scroll = scroll;
+}
+
+static inline void seqd_log_follow(seqd_log* log) {
+    log->scroll = 0;
+}
+
+///////////////////////////////////// Output //////////////////////////////////
+
+static inline void seqd_log_render(seqd_log* log) {
+    unsigned long long end = log->total - log->scroll;
+    unsigned long long first = end > (unsigned long long) log->height ? end - log->height : 0;
+
+    if (!log->full_redraw && end == log->shown_end)
+        return;
+
+    seqd_sgr_set(log->ctx, log->attr);
+    seqd_sgr_flush(log->ctx);
+
+    long long shift = (long long) end - (long long) log->shown_end;
+    bool full = end >= (unsigned long long) log->height;
+    bool was_full = log->shown_end >= (unsigned long long) log->height;
+
+    if (!log->full_redraw && !full && shift > 0) {                      // Still filling from the top, the new lines go under the old ones
+        for (unsigned long long n = log->shown_end; n < end; n++)
+            seqd_log_draw(log, (int) n, n);
+    } else if (!log->full_redraw && full && was_full && shift > -log->height && shift < log->height) {
+        // Lines that are still on screen are moved, only the ones coming into view are written
+        seqd_scroll_region(log->ctx, log->top + 1, log->top + log->height);
+
+        if (shift > 0) {                                                // Newer lines, everything moves up
+            seqd_csi(log->ctx, (int) shift, 'S');                       // SEQD_SCROLL_UP
+            for (int row = log->height - (int) shift; row < log->height; row++)
+                seqd_log_draw(log, row, first + row);
+        } else {                                                        // Back into the history, everything moves down
+            seqd_csi(log->ctx, (int) -shift, 'T');                      // SEQD_SCROLL_DOWN
+            for (int row = 0; row < (int) -shift; row++)
+                seqd_log_draw(log, row, first + row);
+        }
+
+        seqd_buffer(log->ctx, SEQD_SCROLL_REGION_RESET);
+    } else {
+        // A burst of a screenful or more, a jump, or a first render - only the last screenful is written
+        for (int row = 0; row < log->height; row++)
+            seqd_log_draw(log, row, first + row);
+    }
+
+    log->shown_end = end;
+    log->full_redraw = false;
+}
+
+static inline void seqd_log_present(seqd_log* log) {
+    seqd_log_render(log);
+    seqd_display(log->ctx);
+    seqd_clear(log->ctx);
+}
+
+#endif
@@ -0,0 +1,451 @@
+// Seqd loop - header-only extension to seqd.h
+// One poll() based event loop that waits on the keyboard, terminal resizes,
+// timers and any file descriptors the program adds, and only wakes up when
+// one of them has something to do.
+
+#ifndef SEQD_LOOP_H
+#define SEQD_LOOP_H
+
+///////////////////////////////// Dependencies ////////////////////////////////
+#include "seqd.h"
+#include <time.h>
+
+
+///////////////////////// Preprocessor config options /////////////////////////
+
+#ifndef SEQD_LOOP_MAX_FDS
+#define SEQD_LOOP_MAX_FDS 16                                            // User fds a loop can watch
+#endif
+
+#ifndef SEQD_LOOP_MAX_TIMERS
+#define SEQD_LOOP_MAX_TIMERS 16                                         // Timers a loop can have running at once
+#endif
+
+#ifndef SEQD_LOOP_FRAME_INTERVAL
+#define SEQD_LOOP_FRAME_INTERVAL 16                                     // Milliseconds between frames when seqd_loop_on_frame isn't given one, about 60 a second
+#endif
+
+///////////////////////////////////// Docs ////////////////////////////////////
+// Register callbacks, then call seqd_loop_run. Callbacks run on the thread  //
+// that runs the loop, one at a time, and may add or remove fds and timers   //
+// or call seqd_loop_stop.                                                   //
+//                                                                           //
+// Keys are decoded with decode_key as bytes arrive, so the loop never sits  //
+// in keypress_ex's ESC timeout - a lone ESC becomes a deadline instead. The //
+// keyboard is only read while a key callback is set. Keys need raw mode.    //
+//                                                                           //
+// Frames: instead of calling display() after every change, set a frame      //
+// callback and call seqd_loop_redraw. However many redraws are asked for,   //
+// the callback runs at most once per frame interval, on the next tick of a  //
+// clock aligned to that interval. If seqdout isn't writable when the frame  //
+// is due (the last frame is still draining) the frame is skipped and tried  //
+// again on the next tick.                                                   //
+//                                                                           //
+// Functions marked with a "*" have platform-specific behaviour. On Windows  //
+// there is no poll() for the console, so the loop checks the keyboard every //
+// millisecond while it waits and user fds and resize events aren't there.   //
+///////////////////////////////////////////////////////////////////////////////
+
+// Types
+typedef void (*seqd_key_fn)(seqd_key key, void* user);
+typedef void (*seqd_resize_fn)(int width, int height, void* user);      // Only called when the size really changed
+typedef void (*seqd_fd_fn)(int fd, short revents, void* user);          // revents are the poll() flags that fired
+typedef void (*seqd_timer_fn)(int id, void* user);
+typedef void (*seqd_frame_fn)(void* user);                              // Draws and displays one frame
+
+typedef struct seqd_loop_fd {
+    int fd;
+    short events;                                                       // POLLIN, POLLOUT...
+    seqd_fd_fn fn;
+    void* user;
+} seqd_loop_fd;
+
+typedef struct seqd_timer {
+    int id;                                                             // 0 when the slot is free
+    long long deadline;                                                 // seqd_now_ms() time it fires at
+    int interval;                                                       // Repeat every interval ms, 0 for one shot
+    seqd_timer_fn fn;
+    void* user;
+} seqd_timer;
+
+typedef struct seqd_loop {
+    seqd_loop_fd fds[SEQD_LOOP_MAX_FDS];
+    int fd_count;
+    seqd_timer timers[SEQD_LOOP_MAX_TIMERS];
+    int last_timer_id;
+
+    seqd_key_fn on_key;
+    void* key_user;
+    bool keyboard_closed;                                               // stdin hit EOF, stop polling it
+    long long esc_deadline;                                             // When a half received sequence is given up on, 0 when there isn't one
+
+    seqd_resize_fn on_resize;
+    void* resize_user;
+
+    seqd_frame_fn on_frame;
+    void* frame_user;
+    int frame_interval;                                                 // Milliseconds between frame ticks
+    volatile sig_atomic_t redraw;                                       // Set by seqd_loop_redraw, so a signal handler can ask too
+    long long frame_due;                                                // Tick the next frame is drawn on, 0 when none is scheduled
+    long long last_frame;                                               // When the last frame was drawn
+    unsigned long frames_skipped;                                       // Ticks passed over because seqdout wasn't writable
+
+    bool running;
+} seqd_loop;
+
+// Setup
+static inline bool seqd_loop_init(seqd_loop* loop);                     // Sets up the loop and calls watch_terminal_size() for resize events
+static inline void seqd_loop_free(seqd_loop* loop);                     // Forgets every callback
+
+// Sources
+static inline void seqd_loop_on_key(seqd_loop* loop, seqd_key_fn fn, void* user);       // Called for every decoded key, NULL stops reading the keyboard
+static inline void seqd_loop_on_resize(seqd_loop* loop, seqd_resize_fn fn, void* user); // *Called after the terminal window changes size
+static inline bool seqd_loop_add_fd(seqd_loop* loop, int fd, short events, seqd_fd_fn fn, void* user); // *Calls fn whenever fd is ready for events, false when full
+static inline void seqd_loop_remove_fd(seqd_loop* loop, int fd);
+static inline int seqd_loop_add_timer(seqd_loop* loop, int ms, bool repeat, seqd_timer_fn fn, void* user); // Returns the timer id, -1 when full
+static inline void seqd_loop_cancel_timer(seqd_loop* loop, int id);
+
+// Frames
+static inline void seqd_loop_on_frame(seqd_loop* loop, seqd_frame_fn fn, void* user, int interval); // Sets the frame callback, interval <= 0 uses SEQD_LOOP_FRAME_INTERVAL
+static inline void seqd_loop_redraw(seqd_loop* loop);                   // Asks for a frame, many calls before it is drawn still make one frame
+
+// Running
+static inline int seqd_loop_run_once(seqd_loop* loop, int timeout);     // *Waits up to timeout ms (-1 forever) for something to happen, returns how many callbacks ran
+static inline void seqd_loop_run(seqd_loop* loop);                      // Runs until seqd_loop_stop is called
+static inline void seqd_loop_stop(seqd_loop* loop);
+
+// Time
+static inline long long seqd_now_ms();                                  // *Milliseconds on a monotonic clock
+
+////////////////////////////// Utility functions //////////////////////////////
+
+static inline long long seqd_now_ms() {
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        return (long long) GetTickCount64();
+
+    #else                           // POSIX implementation
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+    #endif
+
+}
+
+static inline bool seqd_writable(int fd) {                              // *True when a write to fd won't block, always true on Windows
+    #ifdef _WIN32
+        (void) fd;
+        return true;
+    #else
+        struct pollfd p = { fd, POLLOUT, 0 };
+        return poll(&p, 1, 0) != 0;                                     // Errors count as writable, so the frame's write reports them
+    #endif
+}
+
+static inline void seqd_loop_schedule(seqd_loop* loop, long long now) { // Picks the tick for a requested frame
+    if (loop->on_frame == NULL || !loop->redraw || loop->frame_due != 0)
+        return;
+
+    // The first tick that is both now or later and a whole interval after the last frame
+    long long earliest = loop->last_frame + loop->frame_interval;
+    if (earliest < now)
+        earliest = now;
+
+    loop->frame_due = (earliest + loop->frame_interval - 1) / loop->frame_interval * loop->frame_interval;
+}
+
+static inline int seqd_loop_timeout(seqd_loop* loop, int timeout) {    // Shortens timeout to the next timer, frame or ESC deadline
+    long long now = seqd_now_ms();
+    long long next = -1;
+
+    seqd_loop_schedule(loop, now);
+    if (loop->frame_due != 0)
+        next = loop->frame_due;
+
+    for (int i = 0; i < SEQD_LOOP_MAX_TIMERS; i++)
+        if (loop->timers[i].id != 0 && (next < 0 || loop->timers[i].deadline < next))
+            next = loop->timers[i].deadline;
+
+    if (loop->esc_deadline != 0 && (next < 0 || loop->esc_deadline < next))
+        next = loop->esc_deadline;
+
+    if (loop->on_key != NULL && seqdin_start < seqdin_end && loop->esc_deadline == 0)
+        return 0;                                                       // Whole keys are already waiting in seqdin
+
+    if (next < 0)
+        return timeout;
+
+    int until = next <= now ? 0 : (int) (next - now);
+    return (timeout < 0 || until < timeout) ? until : timeout;
+}
+
+static inline int seqd_loop_keys(seqd_loop* loop) {                     // Hands every complete key in seqdin to the key callback
+    int ran = 0;
+    bool expired = loop->esc_deadline != 0 && seqd_now_ms() >= loop->esc_deadline;
+
+    while (loop->on_key != NULL && seqdin_start < seqdin_end) {
+        seqd_key key;
+        int used = decode_key(seqdin + seqdin_start, seqdin_end - seqdin_start, expired || loop->keyboard_closed, &key);
+
+        if (used == 0) {                                                // Half a sequence, give the rest SEQD_ESC_TIMEOUT to arrive
+            if (loop->esc_deadline == 0)
+                loop->esc_deadline = seqd_now_ms() + SEQD_ESC_TIMEOUT;
+            return ran;
+        }
+
+        seqdin_start += used;
+        loop->esc_deadline = 0;
+        expired = false;
+
+        loop->on_key(key, loop->key_user);
+        ran++;
+    }
+
+    return ran;
+}
+
+static inline int seqd_loop_timers(seqd_loop* loop) {                   // Runs every timer whose deadline has passed
+    int ran = 0;
+    long long now = seqd_now_ms();
+
+    for (int i = 0; i < SEQD_LOOP_MAX_TIMERS; i++) {
+        seqd_timer* t = &loop->timers[i];
+        if (t->id == 0 || t->deadline > now)
+            continue;
+
+        int id = t->id;
+        if (t->interval > 0) {
+            t->deadline += t->interval;
+            if (t->deadline <= now)                                     // Fell behind, skip the missed ticks instead of firing them all
+                t->deadline = now + t->interval;
+        } else {
+            t->id = 0;
+        }
+
+        t->fn(id, t->user);
+        ran++;
+    }
+
+    return ran;
+}
+
+static inline int seqd_loop_frame(seqd_loop* loop) {                    // Draws the frame if its tick has come
+    long long now = seqd_now_ms();
+    seqd_loop_schedule(loop, now);
+
+    if (loop->frame_due == 0 || now < loop->frame_due)
+        return 0;
+
+    if (!seqd_writable(seqdout)) {                                      // Still draining the last frame, try on the next tick
+        loop->frame_due += loop->frame_interval;
+        while (loop->frame_due <= now)
+            loop->frame_due += loop->frame_interval;
+
+        loop->frames_skipped++;
+        return 0;
+    }
+
+    loop->redraw = 0;                                                   // Cleared first, so the callback can ask for the next frame
+    loop->frame_due = 0;
+    loop->last_frame = now;
+
+    loop->on_frame(loop->frame_user);
+    return 1;
+}
+
+///////////////////////////////////// Setup ///////////////////////////////////
+
+static inline bool seqd_loop_init(seqd_loop* loop) {
+    int w, h;
+    memset(loop, 0, sizeof(*loop));
+
+    watch_terminal_size();                                              // Without it there are no resize events, the rest still works
+    terminal_resized(&w, &h);                                           // The size now is the one later resizes compare against
+    return true;
+}
+
+static inline void seqd_loop_free(seqd_loop* loop) {
+    memset(loop, 0, sizeof(*loop));
+}
+
+//////////////////////////////////// Sources //////////////////////////////////
+
+static inline void seqd_loop_on_key(seqd_loop* loop, seqd_key_fn fn, void* user) {
+    loop->on_key = fn;
+    loop->key_user = user;
+}
+
+static inline void seqd_loop_on_resize(seqd_loop* loop, seqd_resize_fn fn, void* user) {
+    loop->on_resize = fn;
+    loop->resize_user = user;
+}
+
+static inline bool seqd_loop_add_fd(seqd_loop* loop, int fd, short events, seqd_fd_fn fn, void* user) {
+    #ifdef _WIN32
+        (void) loop; (void) fd; (void) events; (void) fn; (void) user;
+        return false;
+    #else
+        if (loop->fd_count >= SEQD_LOOP_MAX_FDS)
+            return false;
+
+        seqd_loop_fd* f = &loop->fds[loop->fd_count++];
+        f->fd = fd;
+        f->events = events;
+        f->fn = fn;
+        f->user = user;
+        return true;
+    #endif
+}
+
+static inline void seqd_loop_remove_fd(seqd_loop* loop, int fd) {
+    for (int i = 0; i < loop->fd_count; i++) {
+        if (loop->fds[i].fd == fd) {
+            loop->fds[i] = loop->fds[--loop->fd_count];
+            return;
+        }
+    }
+}
+
+static inline int seqd_loop_add_timer(seqd_loop* loop, int ms, bool repeat, seqd_timer_fn fn, void* user) {
+    for (int i = 0; i < SEQD_LOOP_MAX_TIMERS; i++) {
+        seqd_timer* t = &loop->timers[i];
+        if (t->id != 0)
+            continue;
+
+        if (++loop->last_timer_id <= 0)                                 // Wrapped, ids are always positive
+            loop->last_timer_id = 1;
+
+        t->id = loop->last_timer_id;
+        t->deadline = seqd_now_ms() + ms;
+        t->interval = repeat ? (ms > 0 ? ms : 1) : 0;
+        t->fn = fn;
+        t->user = user;
+        return t->id;
+    }
+
+    return -1;
+}
+
+static inline void seqd_loop_cancel_timer(seqd_loop* loop, int id) {
+    for (int i = 0; i < SEQD_LOOP_MAX_TIMERS; i++)
+        if (loop->timers[i].id == id)
+            loop->timers[i].id = 0;
+}
+
+//////////////////////////////////// Frames ///////////////////////////////////
+
+static inline void seqd_loop_on_frame(seqd_loop* loop, seqd_frame_fn fn, void* user, int interval) {
+    loop->on_frame = fn;
+    loop->frame_user = user;
+    loop->frame_interval = interval > 0 ? interval : SEQD_LOOP_FRAME_INTERVAL;
+    loop->frame_due = 0;
+}
+
+static inline void seqd_loop_redraw(seqd_loop* loop) {
+    loop->redraw = 1;
+}
+
+//////////////////////////////////// Running //////////////////////////////////
+
+static inline int seqd_loop_run_once(seqd_loop* loop, int timeout) {
+    int ran = 0;
+    timeout = seqd_loop_timeout(loop, timeout);
+
+    #ifdef _WIN32                   // WINDOWS implementation
+
+        long long end = seqd_now_ms() + timeout;
+        while (!(loop->on_key != NULL && _kbhit()) && (timeout < 0 || seqd_now_ms() < end))
+            Sleep(1);
+
+        if (loop->on_key != NULL && _kbhit())
+            fill_input(0);
+
+    #else                           // POSIX implementation
+
+        struct pollfd fds[SEQD_LOOP_MAX_FDS + 2];
+        int count = 0;
+        int keyboard = -1, winch = -1;
+
+        if (loop->on_key != NULL && !loop->keyboard_closed) {
+            keyboard = count;
+            fds[count].fd = STDIN_FILENO;
+            fds[count++].events = POLLIN;
+        }
+
+        if (loop->on_resize != NULL && seqdwinch[0] >= 0) {
+            winch = count;
+            fds[count].fd = seqdwinch[0];
+            fds[count++].events = POLLIN;
+        }
+
+        int first_user = count;
+        int user_count = loop->fd_count;                                // Callbacks may add fds, those wait for the next round
+        seqd_loop_fd user_fds[SEQD_LOOP_MAX_FDS];
+        memcpy(user_fds, loop->fds, user_count * sizeof(seqd_loop_fd));
+
+        for (int i = 0; i < user_count; i++) {
+            fds[count].fd = user_fds[i].fd;
+            fds[count++].events = user_fds[i].events;
+        }
+
+        int ready = poll(fds, count, timeout);
+        if (ready < 0) {
+            if (errno != EINTR)
+                loop->running = false;
+            ready = 0;
+        }
+
+        if (ready > 0 && keyboard >= 0 && fds[keyboard].revents) {
+            if (!fill_input(0) && seqdin_eof)                           // Readable but nothing came, stdin is closed
+                loop->keyboard_closed = true;
+        }
+
+        if (ready > 0 && winch >= 0 && (fds[winch].revents & POLLIN)) {
+            char drain[64];
+            while (read(seqdwinch[0], drain, sizeof(drain)) > 0) {}    // Several signals still make one resize
+
+            int w, h;
+            if (terminal_resized(&w, &h)) {
+                loop->on_resize(w, h, loop->resize_user);
+                ran++;
+            }
+        }
+
+        for (int i = 0; ready > 0 && i < user_count; i++) {
+            if (fds[first_user + i].revents == 0)
+                continue;
+
+            bool still_added = false;                                   // An earlier callback may have removed it
+            for (int j = 0; j < loop->fd_count; j++)
+                if (loop->fds[j].fd == user_fds[i].fd && loop->fds[j].fn == user_fds[i].fn)
+                    still_added = true;
+
+            if (still_added) {
+                user_fds[i].fn(user_fds[i].fd, fds[first_user + i].revents, user_fds[i].user);
+                ran++;
+            }
+        }
+
+    #endif
+
+    ran += seqd_loop_keys(loop);
+    ran += seqd_loop_timers(loop);
+    ran += seqd_loop_frame(loop);                                       // Last, so everything that happened this round is in the frame
+    return ran;
+}
+
+static inline void seqd_loop_run(seqd_loop* loop) {
+    loop->running = true;
+
+    while (loop->running)
+        seqd_loop_run_once(loop, -1);
+}
+
+static inline void seqd_loop_stop(seqd_loop* loop) {
+    loop->running = false;
+}
+
+#endif
@@ -0,0 +1,234 @@
+// Seqd parallel - header-only extension to seqd.h
+// Splits a frame into segments (row bands or tiles) that are formatted on a
+// pool of worker threads, each into its own seqd_context. The segments are
+// then joined in order, so the frame is still written once by one thread.
+
+#ifndef SEQD_PARALLEL_H
+#define SEQD_PARALLEL_H
+
+///////////////////////////////// Dependencies ////////////////////////////////
+#include "seqd.h"
+
+#ifndef _WIN32
+    #include <pthread.h>
+#endif
+
+///////////////////////////////////// Docs ////////////////////////////////////
+// The segment callback gets its own context and must only write to that.   //
+// Segments start with an unknown SGR state (see the contexts section of     //
+// seqd.h), and they should position the cursor before drawing, since they  //
+// can't know where the previous segment left it.                           //
+//                                                                           //
+// On Windows the segments are formatted one after another on the calling   //
+// thread, the output is the same.                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// Types
+typedef void (*seqd_segment_fn)(seqd_context* ctx, int index, void* user); // Formats segment "index" into ctx
+
+typedef struct seqd_pool {
+    int threads;                                                        // Worker threads, not counting the caller of seqd_pool_render
+    seqd_context* ctxs;                                                 // One context per segment, kept between frames
+    int ctx_count;
+
+    #ifndef _WIN32
+        pthread_t* workers;
+        pthread_mutex_t lock;
+        pthread_cond_t start;                                           // Broadcast when a frame is ready
+        pthread_cond_t done;                                            // Signalled when the last segment is finished
+        unsigned long frame;                                            // Bumped for every frame, workers wait for it to change
+        bool stopping;
+    #endif
+
+    seqd_segment_fn fn;                                                 // Current frame, only changed under lock
+    void* user;
+    int count;
+    int next;
+    int remaining;
+} seqd_pool;
+
+// Pool
+static inline bool seqd_pool_init(seqd_pool* p, int threads);           // *Starts the workers, threads <= 0 picks one less than the number of cores, returns false on failure
+static inline void seqd_pool_free(seqd_pool* p);                        // *Stops the workers and frees every segment context
+static inline bool seqd_pool_render(seqd_pool* p, seqd_context* out, int count, seqd_segment_fn fn, void* user); // Formats count segments in parallel then appends them to out in order
+
+// Helpers
+static inline void seqd_band(int index, int count, int height, int* first_row, int* rows); // Splits height rows into count bands, first_row is 1 based like SEQD_SETCUR
+
+////////////////////////////// Utility functions //////////////////////////////
+
+static inline void seqd_band(int index, int count, int height, int* first_row, int* rows) {
+    int start = (int) ((long) height * index / count);
+    int end = (int) ((long) height * (index + 1) / count);
+
+    *first_row = start + 1;
+    *rows = end - start;
+}
+
+static inline bool seqd_pool_contexts(seqd_pool* p, int count) {       // Makes sure there is a context for every segment
+    if (count <= p->ctx_count)
+        return true;
+
+    seqd_context* ctxs = (seqd_context*) realloc(p->ctxs, count * sizeof(seqd_context));
+    if (ctxs == NULL)
+        return false;
+
+    memset(ctxs + p->ctx_count, 0, (count - p->ctx_count) * sizeof(seqd_context));
+    p->ctxs = ctxs;
+    p->ctx_count = count;
+    return true;
+}
+
+////////////////////////// Platform specific functions ////////////////////////
+
+#ifdef _WIN32                                                           // WINDOWS implementation, no workers
+
+static inline bool seqd_pool_init(seqd_pool* p, int threads) {
+    (void) threads;
+    memset(p, 0, sizeof(*p));
+    return true;
+}
+
+static inline void seqd_pool_free(seqd_pool* p) {
+    for (int i = 0; i < p->ctx_count; i++)
+        seqd_context_free(&p->ctxs[i]);
+
+    free(p->ctxs);
+    memset(p, 0, sizeof(*p));
+}
+
+static inline void seqd_pool_run(seqd_pool* p, int count, seqd_segment_fn fn, void* user) {
+    for (int i = 0; i < count; i++)
+        fn(&p->ctxs[i], i, user);
+}
+
+#else                                                                   // POSIX implementation
+
+static inline void seqd_pool_work(seqd_pool* p) {                       // Takes segments until none are left, called with the lock held
+    while (p->next < p->count) {
+        int index = p->next++;
+        seqd_segment_fn fn = p->fn;                                     // Read while the lock is still held
+        seqd_context* ctx = &p->ctxs[index];
+        void* user = p->user;
+
+        pthread_mutex_unlock(&p->lock);
+        fn(ctx, index, user);
+        pthread_mutex_lock(&p->lock);
+
+        if (--p->remaining == 0)
+            pthread_cond_signal(&p->done);
+    }
+}
+
+static inline void* seqd_pool_worker(void* arg) {
+    seqd_pool* p = (seqd_pool*) arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&p->lock);
+
+    while (true) {
+        while (!p->stopping && p->frame == seen)
+            pthread_cond_wait(&p->start, &p->lock);
+
+        if (p->stopping)
+            break;
+
+        seen = p->frame;
+        seqd_pool_work(p);
+    }
+
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static inline bool seqd_pool_init(seqd_pool* p, int threads) {
+    memset(p, 0, sizeof(*p));
+
+    if (threads <= 0)
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN) - 1;              // The caller of seqd_pool_render works too
+
+    if (threads < 0)
+        threads = 0;
+
+    p->workers = (pthread_t*) malloc((threads ? threads : 1) * sizeof(pthread_t));
+    if (p->workers == NULL)
+        return false;
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->done, NULL);
+
+    for (p->threads = 0; p->threads < threads; p->threads++)
+        if (pthread_create(&p->workers[p->threads], NULL, seqd_pool_worker, p) != 0)
+            break;                                                      // Run with however many did start
+
+    return true;
+}
+
+static inline void seqd_pool_free(seqd_pool* p) {
+    pthread_mutex_lock(&p->lock);
+    p->stopping = true;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->threads; i++)
+        pthread_join(p->workers[i], NULL);
+
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->start);
+    pthread_cond_destroy(&p->done);
+
+    for (int i = 0; i < p->ctx_count; i++)
+        seqd_context_free(&p->ctxs[i]);
+
+    free(p->ctxs);
+    free(p->workers);
+    memset(p, 0, sizeof(*p));
+}
+
+static inline void seqd_pool_run(seqd_pool* p, int count, seqd_segment_fn fn, void* user) {
+    pthread_mutex_lock(&p->lock);
+
+    p->fn = fn;                                                         // Published under the lock, workers read them under it too
+    p->user = user;
+    p->count = count;
+    p->next = 0;
+    p->remaining = count;
+    p->frame++;
+    pthread_cond_broadcast(&p->start);
+
+    seqd_pool_work(p);                                                  // The caller takes segments too instead of sitting idle
+    while (p->remaining > 0)
+        pthread_cond_wait(&p->done, &p->lock);
+
+    pthread_mutex_unlock(&p->lock);
+}
+
+#endif
+
+////////////////////////// Cross platform functions ///////////////////////////
+
+static inline bool seqd_pool_render(seqd_pool* p, seqd_context* out, int count, seqd_segment_fn fn, void* user) {
+    if (count <= 0)
+        return true;
+
+    if (!seqd_pool_contexts(p, count))
+        return false;
+
+    for (int i = 0; i < count; i++) {
+        seqd_clear(&p->ctxs[i]);
+        seqd_arena_reset(&p->ctxs[i]);                                  // Segment contexts are never displayed themselves
+        seqd_sgr_invalidate(&p->ctxs[i]);                               // Each segment follows output it knows nothing about
+    }
+
+    seqd_pool_run(p, count, fn, user);
+
+    for (int i = 0; i < count; i++)                                     // Joined in segment order on this thread only
+        if (seqd_append(out, &p->ctxs[i]) == NULL && p->ctxs[i].size > 0)
+            return false;
+
+    seqd_sgr_invalidate(out);                                           // out can't know what the last segment left the attributes as
+    return true;
+}
+
+#endif
@@ -0,0 +1,236 @@
+// Seqd screen - header-only extension to seqd.h
+// Keeps a front (what the terminal shows) and back (what the next frame
+// should show) grid of cells. present() only sends the cells that changed.
+
+#ifndef SEQD_SCREEN_H
+#define SEQD_SCREEN_H
+
+///////////////////////////////// Dependencies ////////////////////////////////
+#include "seqd.h"
+
+///////////////////////////////////// Docs ////////////////////////////////////
+// Rows and columns are 0 based here, unlike SEQD_SETCUR which is 1 based.   //
+//                                                                           //
+// Draw into the back grid with seqd_screen_put/print, then call             //
+// seqd_screen_present once per frame. Anything else queued in the screen's  //
+// context (seqdctx by default) is flushed along with the frame. Attributes  //
+// go through the sgr_ functions, so the screen and hand written sgr_ calls  //
+// stay in sync.                                                             //
+//                                                                           //
+// Cells follow char_width. A wide character takes its cell and the one to   //
+// its right, which holds ch 0 and is never written itself. One that doesn't //
+// fit in the last column becomes a blank. Zero width characters (combining  //
+// marks) are dropped, a cell only holds one codepoint.                      //
+///////////////////////////////////////////////////////////////////////////////
+
+// Types
+typedef struct seqd_cell {
+    unsigned int ch;                                                    // Unicode codepoint
+    seqd_attr attr;                                                     // SEQD_COLOUR_ and SEQD_STYLE_ values
+} seqd_cell;
+
+typedef struct seqd_screen {
+    int width;
+    int height;
+    seqd_cell* front;                                                   // What the terminal currently shows
+    seqd_cell* back;                                                    // What the next frame should show
+    int cur_row;                                                        // Where the terminal cursor is, -1 when unknown
+    int cur_col;
+    bool full_redraw;                                                   // Set after init/resize/invalidate, repaints every cell
+    seqd_context* ctx;                                                  // Where render queues its output, seqdctx unless set otherwise
+} seqd_screen;
+
+// Setup
+static inline bool seqd_screen_init(seqd_screen* s);                    // Sizes the screen from get_terminal_size(), returns false on failure
+static inline bool seqd_screen_resize(seqd_screen* s, int w, int h);    // Resizes both grids and blanks them, the next present repaints everything
+static inline void seqd_screen_free(seqd_screen* s);                    // Frees both grids
+static inline void seqd_screen_invalidate(seqd_screen* s);              // Forget what the terminal shows, the next present repaints everything
+
+// Drawing (back grid)
+static inline void seqd_screen_clear(seqd_screen* s);                   // Blanks the back grid
+static inline seqd_cell* seqd_screen_cell(seqd_screen* s, int row, int col); // Returns the back grid cell, NULL when out of bounds
+static inline void seqd_screen_put(seqd_screen* s, int row, int col, unsigned int ch, unsigned int fg, unsigned int bg, unsigned int style); // Wide characters fill col and col + 1
+static inline int seqd_screen_print(seqd_screen* s, int row, int col, const char* utf8, unsigned int fg, unsigned int bg, unsigned int style); // Returns the number of columns written, clipped at the right edge
+
+// Output
+static inline void seqd_screen_render(seqd_screen* s);                  // Queues the difference between back and front into s->ctx, then front = back
+static inline void seqd_screen_present(seqd_screen* s);                 // seqd_screen_render, then displays and clears s->ctx
+
+////////////////////////////// Utility functions //////////////////////////////
+
+static inline bool seqd_cell_equal(const seqd_cell* a, const seqd_cell* b) {
+    return a->ch == b->ch && a->attr.fg == b->attr.fg && a->attr.bg == b->attr.bg && a->attr.style == b->attr.style;
+}
+
+static inline seqd_cell seqd_cell_blank() {
+    seqd_cell c = { ' ', { SEQD_COLOUR_DEFAULT, SEQD_COLOUR_DEFAULT, 0 } };
+    return c;
+}
+
+static inline void seqd_screen_move(seqd_screen* s, int row, int col) { // Queues the shortest cursor move known to get to row, col
+    if (s->cur_row == row && s->cur_col == col)
+        return;
+
+    if (s->cur_row == row && s->cur_col >= 0 && s->cur_col < col)
+        seqd_csi(s->ctx, col - s->cur_col, 'C');                        // SEQD_CUR_FORWARD
+    else
+        seqd_setcur(s->ctx, row + 1, col + 1);
+
+    s->cur_row = row;
+    s->cur_col = col;
+}
+
+///////////////////////////////////// Setup ///////////////////////////////////
+
+static inline bool seqd_screen_resize(seqd_screen* s, int w, int h) {
+    if (w <= 0 || h <= 0)
+        return false;
+
+    size_t count = (size_t) w * (size_t) h;
+    seqd_cell* front = (seqd_cell*) realloc(s->front, count * sizeof(seqd_cell));
+    if (front == NULL)
+        return false;
+    s->front = front;
+
+    seqd_cell* back = (seqd_cell*) realloc(s->back, count * sizeof(seqd_cell));
+    if (back == NULL)
+        return false;
+    s->back = back;
+
+    if (s->ctx == NULL)
+        s->ctx = &seqdctx;
+
+    s->width = w;
+    s->height = h;
+    seqd_screen_clear(s);
+    seqd_screen_invalidate(s);
+    return true;
+}
+
+static inline bool seqd_screen_init(seqd_screen* s) {
+    int w = 0, h = 0;
+    memset(s, 0, sizeof(*s));
+
+    get_terminal_size(&w, &h);
+    return seqd_screen_resize(s, w, h);
+}
+
+static inline void seqd_screen_free(seqd_screen* s) {
+    free(s->front);
+    free(s->back);
+    memset(s, 0, sizeof(*s));
+}
+
+static inline void seqd_screen_invalidate(seqd_screen* s) {
+    s->full_redraw = true;
+    s->cur_row = -1;
+    s->cur_col = -1;
+}
+
+//////////////////////////////////// Drawing //////////////////////////////////
+
+static inline void seqd_screen_clear(seqd_screen* s) {
+    seqd_cell blank = seqd_cell_blank();
+    for (int i = 0; i < s->width * s->height; i++)
+        s->back[i] = blank;
+}
+
+static inline seqd_cell* seqd_screen_cell(seqd_screen* s, int row, int col) {
+    if (row < 0 || col < 0 || row >= s->height || col >= s->width)
+        return NULL;
+
+    return &s->back[row * s->width + col];
+}
+
+static inline void seqd_screen_put(seqd_screen* s, int row, int col, unsigned int ch, unsigned int fg, unsigned int bg, unsigned int style) {
+    seqd_cell* c = seqd_screen_cell(s, row, col);
+    int width = char_width(ch);
+    if (c == NULL || width == 0)
+        return;
+
+    if (width == 2 && col == s->width - 1)                              // Half a wide character can't be shown
+        ch = ' ';
+
+    if (c->ch == 0 && col > 0)                                          // Overwriting the right half of a wide character, its left half goes too
+        c[-1] = seqd_cell_blank();
+    if (col + 1 < s->width && c[1].ch == 0 && c->ch != 0 && char_width(c->ch) == 2)
+        c[1] = seqd_cell_blank();                                       // Overwriting the left half, the right half goes too
+
+    c->ch = ch;
+    c->attr.fg = fg;
+    c->attr.bg = bg;
+    c->attr.style = style;
+
+    if (ch != ' ' && width == 2) {
+        if (col + 2 < s->width && c[2].ch == 0)                         // The continuation lands on another wide character's left half
+            c[2] = seqd_cell_blank();
+
+        c[1].ch = 0;
+        c[1].attr = c->attr;
+    }
+}
+
+static inline int seqd_screen_print(seqd_screen* s, int row, int col, const char* utf8, unsigned int fg, unsigned int bg, unsigned int style) {
+    int written = 0;
+
+    while (*utf8 != '\0' && col + written < s->width) {
+        unsigned int ch = seqd_utf8_decode(&utf8);
+        int width = char_width(ch);
+        if (col + written + width > s->width)                            // A wide character that would be cut in half ends the line
+            break;
+
+        seqd_screen_put(s, row, col + written, ch, fg, bg, style);
+        written += width;
+    }
+
+    return written;
+}
+
+//////////////////////////////////// Output ///////////////////////////////////
+
+static inline void seqd_screen_render(seqd_screen* s) {
+    if (s->full_redraw) {                                               // The attributes and cursor are unknown, start from a clean state
+        seqd_sgr_invalidate(s->ctx);
+        s->cur_row = -1;
+        s->cur_col = -1;
+    }
+
+    for (int row = 0; row < s->height; row++) {
+        seqd_cell* front = &s->front[row * s->width];
+        seqd_cell* back = &s->back[row * s->width];
+
+        for (int col = 0; col < s->width; col++) {
+            if (back[col].ch == 0) {                                    // Drawn along with the wide character before it
+                front[col] = back[col];
+                continue;
+            }
+
+            bool wide = col + 1 < s->width && back[col + 1].ch == 0;
+            if (!s->full_redraw && seqd_cell_equal(&front[col], &back[col]) && (!wide || seqd_cell_equal(&front[col + 1], &back[col + 1])))
+                continue;
+
+            char utf8[4];
+            seqd_screen_move(s, row, col);
+            seqd_sgr_set(s->ctx, back[col].attr);
+            seqd_sgr_flush(s->ctx);
+            seqd_buffer_n(s->ctx, utf8, seqd_utf8_encode(back[col].ch, utf8));
+            front[col] = back[col];
+
+            s->cur_col += wide ? 2 : 1;
+            if (s->cur_col >= s->width) {                               // Terminals differ on where the cursor sits after the last column
+                s->cur_row = -1;
+                s->cur_col = -1;
+            }
+        }
+    }
+
+    s->full_redraw = false;
+}
+
+static inline void seqd_screen_present(seqd_screen* s) {
+    seqd_screen_render(s);
+    seqd_display(s->ctx);
+    seqd_clear(s->ctx);
+}
+
+#endif
@@ -0,0 +1,754 @@
+// Seqd vt - header-only extension to seqd.h
+// A headless terminal. Output is parsed into a grid of cells instead of being
+// written to a tty, so frames can be checked, compared and measured without a
+// real terminal. The byte stream can be recorded to a file and replayed later
+// as fast as it parses.
+
+#ifndef SEQD_VT_H
+#define SEQD_VT_H
+
+///////////////////////////////// Dependencies ////////////////////////////////
+#include "seqd.h"
+#include "seqd_screen.h"
+
+///////////////////////// Preprocessor config options /////////////////////////
+
+#ifndef SEQD_VT_MAX_PARAMS
+#define SEQD_VT_MAX_PARAMS 32                                           // CSI parameters kept, any after that are dropped - sgr_transition writes up to 19 (0, 8 styles, 38;2;r;g;b and 48;2;r;g;b)
+#endif
+
+#ifndef SEQD_VT_REPLAY_CHUNK
+#define SEQD_VT_REPLAY_CHUNK 65536                                      // Bytes read from a recording at a time
+#endif
+
+///////////////////////////////////// Docs ////////////////////////////////////
+// Rows and columns are 0 based, like seqd_screen.h, and cells are the same  //
+// seqd_cell. The second half of a wide character holds ch 0.                //
+//                                                                           //
+// The model covers what seqd emits: printable UTF-8 with autowrap, CR, LF,  //
+// BS, TAB, the CSI cursor moves (A-G, H, f, d), erase (J, K, X), insert and //
+// delete (@, P, L, M), scrolling (S, T, DECSTBM, ESC D/M/E), save/restore   //
+// (s, u, ESC 7/8), SGR (16, 256 and RGB colours and the SEQD_STYLE_ set),   //
+// cursor visibility and synchronized output. Anything else is parsed and    //
+// skipped, and counted in unknown. LF also returns to column 0, because the //
+// tty does that for seqd programs (OPOST is left on). Erasing fills cells   //
+// with the current background, like xterm.                                  //
+//                                                                           //
+// Render into a context as usual and hand it to seqd_vt_present instead of  //
+// seqd_display. It feeds the frame, counts its size and clears the context. //
+// Frame mode markers (set_frame_mode) are not added. Programs that write to //
+// seqdout can be captured with set_output_fd(file), and the file replayed.  //
+// Recordings are the raw byte stream, so they also play back with `cat`.    //
+//                                                                           //
+// Queries (SEQD_CURPOS) are never answered.                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+// Types
+typedef struct seqd_vt {
+    int width;
+    int height;
+    seqd_cell* cells;                                                   // width * height, row by row
+
+    int row;                                                            // Cursor
+    int col;
+    bool wrap_pending;                                                  // Something was written in the last column, the next character wraps first
+    int saved_row;
+    int saved_col;
+    seqd_attr saved_attr;
+    int top;                                                            // Scroll region, inclusive
+    int bottom;
+    seqd_attr attr;                                                     // Pen for the next character
+    bool cursor_visible;
+    bool sync;                                                          // Between SEQD_SYNC_BEGIN and SEQD_SYNC_END
+
+    int state;                                                          // Parser
+    int params[SEQD_VT_MAX_PARAMS];
+    int param_count;
+    bool overflow;                                                      // The CSI being parsed has more than SEQD_VT_MAX_PARAMS parameters, the rest are skipped
+    char marker;                                                        // Private marker of the CSI being parsed ('?', '>'...), 0 for none
+    bool intermediate;                                                  // The CSI being parsed has intermediate bytes, none of those are supported
+    unsigned int utf8;                                                  // Codepoint being decoded
+    int utf8_left;                                                      // Continuation bytes still expected
+
+    unsigned long long bytes;                                           // Everything fed so far
+    unsigned long long sequences;                                       // Escape sequences parsed
+    unsigned long long unknown;                                         // Escape sequences the model skipped
+    unsigned long long frames;                                          // seqd_vt_present calls
+    unsigned long long last_frame_bytes;
+    unsigned long long max_frame_bytes;
+
+    FILE* record;                                                       // Everything fed is appended here while recording, NULL otherwise
+} seqd_vt;
+
+// Setup
+static inline bool seqd_vt_init(seqd_vt* vt, int width, int height);    // A blank width x height terminal, false on failure
+static inline void seqd_vt_free(seqd_vt* vt);                           // Frees the grid and stops recording
+static inline bool seqd_vt_copy(seqd_vt* dst, const seqd_vt* src);      // Snapshot of src into an initialised or zeroed dst (not recording), false on failure
+static inline void seqd_vt_reset(seqd_vt* vt);                          // Blank screen, cursor home, default attributes and region, like ESC c - the counters are kept
+
+// Input
+static inline void seqd_vt_feed(seqd_vt* vt, const char* data, size_t size); // Parses bytes, sequences may be split across calls
+static inline void seqd_vt_present(seqd_vt* vt, seqd_context* ctx);     // seqd_display into the terminal: feeds ctx's buffer as one frame, then clears ctx
+
+// Inspection
+static inline const seqd_cell* seqd_vt_cell(const seqd_vt* vt, int row, int col); // NULL when out of bounds
+static inline int seqd_vt_row_text(const seqd_vt* vt, int row, char* out, int size); // A row as UTF-8 without trailing blanks, null terminated - returns its length
+static inline int seqd_vt_diff(const seqd_vt* a, const seqd_vt* b, int fd); // Cells that differ, -1 if the sizes do - describes each differing row to fd unless fd < 0
+static inline bool seqd_vt_dump(const seqd_vt* vt, int fd);             // Writes the text of every row and the cursor position to fd
+
+// Recording
+static inline bool seqd_vt_record(seqd_vt* vt, const char* path);       // Starts writing everything fed to path (replacing it), NULL stops - false if it can't be opened
+static inline long long seqd_vt_replay(seqd_vt* vt, const char* path);  // Feeds a whole recording, returns the bytes fed or -1 if it can't be read
+
+////////////////////////////// Utility functions //////////////////////////////
+
+enum { SEQD_VT_GROUND, SEQD_VT_ESCAPE, SEQD_VT_ESCAPE_INTERMEDIATE, SEQD_VT_CSI, SEQD_VT_STRING, SEQD_VT_STRING_ESCAPE };
+
+static inline seqd_cell seqd_vt_blank(const seqd_vt* vt) {              // What erased cells become
+    seqd_cell c = { ' ', { SEQD_COLOUR_DEFAULT, vt->attr.bg, 0 } };
+    return c;
+}
+
+static inline void seqd_vt_fill(seqd_vt* vt, int row, int from, int to) { // Blanks columns from to to - 1 of a row
+    seqd_cell blank = seqd_vt_blank(vt);
+    seqd_cell* line = &vt->cells[row * vt->width];
+
+    for (int col = from; col < to; col++)
+        line[col] = blank;
+}
+
+static inline void seqd_vt_scroll_up(seqd_vt* vt, int top, int n) {     // Moves rows top to bottom up by n, blank rows come in at the bottom
+    int rows = vt->bottom - top + 1;
+    if (top > vt->bottom || n <= 0)
+        return;
+    if (n > rows)
+        n = rows;
+
+    memmove(&vt->cells[top * vt->width], &vt->cells[(top + n) * vt->width], (size_t) (rows - n) * vt->width * sizeof(seqd_cell));
+
+    for (int row = vt->bottom - n + 1; row <= vt->bottom; row++)
+        seqd_vt_fill(vt, row, 0, vt->width);
+}
+
+static inline void seqd_vt_scroll_down(seqd_vt* vt, int top, int n) {   // Moves rows top to bottom down by n, blank rows come in at top
+    int rows = vt->bottom - top + 1;
+    if (top > vt->bottom || n <= 0)
+        return;
+    if (n > rows)
+        n = rows;
+
+    memmove(&vt->cells[(top + n) * vt->width], &vt->cells[top * vt->width], (size_t) (rows - n) * vt->width * sizeof(seqd_cell));
+
+    for (int row = top; row < top + n; row++)
+        seqd_vt_fill(vt, row, 0, vt->width);
+}
+
+static inline void seqd_vt_move(seqd_vt* vt, int row, int col) {        // Clamped to the screen
+    vt->row = row < 0 ? 0 : row >= vt->height ? vt->height - 1 : row;
+    vt->col = col < 0 ? 0 : col >= vt->width ? vt->width - 1 : col;
+    vt->wrap_pending = false;
+}
+
+static inline void seqd_vt_index(seqd_vt* vt) {                         // Down a row, scrolling at the bottom of the region
+    if (vt->row == vt->bottom)
+        seqd_vt_scroll_up(vt, vt->top, 1);
+    else if (vt->row < vt->height - 1)
+        vt->row++;
+
+    vt->wrap_pending = false;
+}
+
+static inline void seqd_vt_reverse_index(seqd_vt* vt) {                 // Up a row, scrolling at the top of the region
+    if (vt->row == vt->top)
+        seqd_vt_scroll_down(vt, vt->top, 1);
+    else if (vt->row > 0)
+        vt->row--;
+
+    vt->wrap_pending = false;
+}
+
+static inline void seqd_vt_print(seqd_vt* vt, unsigned int ch) {
+    int width = char_width(ch);
+    if (width == 0)                                                     // Combining marks stay with the cell before, which isn't modelled
+        return;
+
+    if (vt->wrap_pending || (width == 2 && vt->col == vt->width - 1)) {
+        if (width == 2 && !vt->wrap_pending)                            // A wide character that doesn't fit leaves the last column blank
+            seqd_vt_fill(vt, vt->row, vt->col, vt->width);
+
+        vt->col = 0;
+        seqd_vt_index(vt);
+    }
+
+    seqd_cell* cell = &vt->cells[vt->row * vt->width + vt->col];
+    seqd_cell blank = seqd_vt_blank(vt);
+
+    if (cell->ch == 0 && vt->col > 0)                                   // Half of a wide character can't stay, the other half is erased
+        cell[-1] = blank;
+    if (vt->col + 1 < vt->width && cell[1].ch == 0)
+        cell[1] = blank;
+    if (width == 2 && vt->col + 2 < vt->width && cell[2].ch == 0)
+        cell[2] = blank;
+
+    cell->ch = ch;
+    cell->attr = vt->attr;
+
+    if (width == 2 && vt->width > 1) {
+        cell[1].ch = 0;
+        cell[1].attr = vt->attr;
+        vt->col++;
+    }
+
+    if (vt->col == vt->width - 1)
+        vt->wrap_pending = true;
+    else
+        vt->col++;
+}
+
+static inline int seqd_vt_param(const seqd_vt* vt, int i, int fallback) { // Parameter i, fallback when it is missing or 0
+    return i < vt->param_count && vt->params[i] > 0 ? vt->params[i] : fallback;
+}
+
+static inline unsigned int seqd_vt_sgr_colour(const seqd_vt* vt, int* i) { // Reads 5;n or 2;r;g;b after a 38 or 48, leaves *i on the last parameter used
+    int kind = *i + 1 < vt->param_count ? vt->params[*i + 1] : -1;
+
+    if (kind == 5 && *i + 2 < vt->param_count) {
+        *i += 2;
+        return SEQD_COLOUR_256(vt->params[*i]);
+    }
+
+    if (kind == 2 && *i + 4 < vt->param_count) {
+        *i += 4;
+        return SEQD_COLOUR_RGB(vt->params[*i - 2], vt->params[*i - 1], vt->params[*i]);
+    }
+
+    *i = vt->param_count;                                               // Malformed, the rest can't be trusted
+    return SEQD_COLOUR_DEFAULT;
+}
+
+static inline void seqd_vt_sgr(seqd_vt* vt) {
+    static const unsigned int styles[10] = { 0, SEQD_STYLE_BOLD, SEQD_STYLE_FAINT, SEQD_STYLE_ITALIC, SEQD_STYLE_UNDERLINE,
+                                             SEQD_STYLE_BLINK, SEQD_STYLE_BLINK, SEQD_STYLE_REVERSE, SEQD_STYLE_CONCEAL, SEQD_STYLE_CROSSED_OUT };
+
+    if (vt->param_count == 0)                                           // ESC[m is ESC[0m
+        vt->params[vt->param_count++] = 0;
+
+    for (int i = 0; i < vt->param_count; i++) {
+        int p = vt->params[i];
+
+        if (p == 0) {
+            vt->attr.fg = vt->attr.bg = SEQD_COLOUR_DEFAULT;
+            vt->attr.style = 0;
+        } else if (p < 10) {
+            vt->attr.style |= styles[p];
+        } else if (p == 22) {
+            vt->attr.style &= ~(SEQD_STYLE_BOLD | SEQD_STYLE_FAINT);
+        } else if (p > 22 && p < 30 && p != 26) {
+            vt->attr.style &= ~styles[p - 20];
+        } else if (p >= 30 && p <= 37) {
+            vt->attr.fg = SEQD_COLOUR_256(p - 30);
+        } else if (p == 38) {
+            vt->attr.fg = seqd_vt_sgr_colour(vt, &i);
+        } else if (p == 39) {
+            vt->attr.fg = SEQD_COLOUR_DEFAULT;
+        } else if (p >= 40 && p <= 47) {
+            vt->attr.bg = SEQD_COLOUR_256(p - 40);
+        } else if (p == 48) {
+            vt->attr.bg = seqd_vt_sgr_colour(vt, &i);
+        } else if (p == 49) {
+            vt->attr.bg = SEQD_COLOUR_DEFAULT;
+        } else if (p >= 90 && p <= 97) {
+            vt->attr.fg = SEQD_COLOUR_256(p - 90 + 8);
+        } else if (p >= 100 && p <= 107) {
+            vt->attr.bg = SEQD_COLOUR_256(p - 100 + 8);
+        }
+    }
+}
+
+static inline void seqd_vt_erase(seqd_vt* vt, char final) {             // J and K
+    int mode = vt->param_count > 0 ? vt->params[0] : 0;
+    int from = mode == 0 ? vt->col : 0;
+    int to = mode == 1 ? vt->col + 1 : vt->width;
+
+    seqd_vt_fill(vt, vt->row, from, to);
+
+    if (final == 'J') {
+        for (int row = 0; row < vt->height; row++) {
+            if ((row > vt->row && mode != 1) || (row < vt->row && mode != 0))
+                seqd_vt_fill(vt, row, 0, vt->width);
+        }
+    }
+}
+
+static inline void seqd_vt_shift_chars(seqd_vt* vt, int n, bool insert) { // @ and P, cells right of the cursor move and blanks fill the gap
+    seqd_cell* line = &vt->cells[vt->row * vt->width];
+    int rest = vt->width - vt->col;
+    if (n > rest)
+        n = rest;
+
+    if (insert) {
+        memmove(&line[vt->col + n], &line[vt->col], (size_t) (rest - n) * sizeof(seqd_cell));
+        seqd_vt_fill(vt, vt->row, vt->col, vt->col + n);
+    } else {
+        memmove(&line[vt->col], &line[vt->col + n], (size_t) (rest - n) * sizeof(seqd_cell));
+        seqd_vt_fill(vt, vt->row, vt->width - n, vt->width);
+    }
+}
+
+static inline void seqd_vt_csi(seqd_vt* vt, char final) {
+    int n = seqd_vt_param(vt, 0, 1);
+    vt->sequences++;
+
+    if (vt->intermediate) {
+        vt->unknown++;
+        return;
+    }
+
+    if (vt->marker != 0) {                                              // Private modes, only ?25 and ?2026 mean anything here
+        bool set = final == 'h';
+        if (vt->marker != '?' || (final != 'h' && final != 'l')) {
+            vt->unknown++;
+            return;
+        }
+
+        for (int i = 0; i < vt->param_count; i++) {
+            if (vt->params[i] == 25)
+                vt->cursor_visible = set;
+            else if (vt->params[i] == 2026)
+                vt->sync = set;
+            else
+                vt->unknown++;
+        }
+        return;
+    }
+
+    int top = vt->row >= vt->top ? vt->top : 0;                         // Vertical moves stop at the region's margins when they start inside it
+    int bottom = vt->row <= vt->bottom ? vt->bottom : vt->height - 1;
+
+    switch (final) {
+        case 'A': seqd_vt_move(vt, vt->row - n < top ? top : vt->row - n, vt->col); break;
+        case 'B': seqd_vt_move(vt, vt->row + n > bottom ? bottom : vt->row + n, vt->col); break;
+        case 'C': seqd_vt_move(vt, vt->row, vt->col + n); break;
+        case 'D': seqd_vt_move(vt, vt->row, vt->col - n); break;
+        case 'E': seqd_vt_move(vt, vt->row + n > bottom ? bottom : vt->row + n, 0); break;
+        case 'F': seqd_vt_move(vt, vt->row - n < top ? top : vt->row - n, 0); break;
+        case 'G': seqd_vt_move(vt, vt->row, n - 1); break;
+        case 'd': seqd_vt_move(vt, n - 1, vt->col); break;
+        case 'H':
+        case 'f': seqd_vt_move(vt, n - 1, seqd_vt_param(vt, 1, 1) - 1); break;
+
+        case 'J':
+        case 'K': seqd_vt_erase(vt, final); break;
+        case 'X': seqd_vt_fill(vt, vt->row, vt->col, vt->col + n > vt->width ? vt->width : vt->col + n); break;
+        case '@': seqd_vt_shift_chars(vt, n, true); break;
+        case 'P': seqd_vt_shift_chars(vt, n, false); break;
+
+        case 'L':                                                       // Insert and delete lines only work inside the region
+            if (vt->row >= vt->top && vt->row <= vt->bottom)
+                seqd_vt_scroll_down(vt, vt->row, n);
+            vt->col = 0;
+            vt->wrap_pending = false;
+            break;
+        case 'M':
+            if (vt->row >= vt->top && vt->row <= vt->bottom)
+                seqd_vt_scroll_up(vt, vt->row, n);
+            vt->col = 0;
+            vt->wrap_pending = false;
+            break;
+
+        case 'S': seqd_vt_scroll_up(vt, vt->top, n); break;
+        case 'T': seqd_vt_scroll_down(vt, vt->top, n); break;
+
+        case 'r': {                                                     // DECSTBM, an invalid region is ignored
+            int t = seqd_vt_param(vt, 0, 1) - 1;
+            int b = seqd_vt_param(vt, 1, vt->height) - 1;
+            if (b >= vt->height)
+                b = vt->height - 1;
+
+            if (t < b) {
+                vt->top = t;
+                vt->bottom = b;
+                seqd_vt_move(vt, 0, 0);
+            }
+            break;
+        }
+
+        case 'm': seqd_vt_sgr(vt); break;
+        case 's': vt->saved_row = vt->row; vt->saved_col = vt->col; vt->saved_attr = vt->attr; break;
+        case 'u': seqd_vt_move(vt, vt->saved_row, vt->saved_col); vt->attr = vt->saved_attr; break;
+        case 'n': break;                                                // Queries, nothing answers
+
+        default:
+            vt->unknown++;
+            break;
+    }
+}
+
+static inline void seqd_vt_escape(seqd_vt* vt, char final) {            // ESC followed by a single byte
+    vt->sequences++;
+    vt->state = SEQD_VT_GROUND;
+
+    switch (final) {
+        case '[':
+            vt->state = SEQD_VT_CSI;
+            vt->sequences--;                                            // Counted when the CSI ends
+            vt->param_count = 0;
+            vt->overflow = false;
+            vt->marker = 0;
+            vt->intermediate = false;
+            break;
+
+        case ']': case 'P': case '_': case '^': case 'X':               // OSC, DCS, APC, PM, SOS - skipped up to BEL or ESC '\'
+            vt->state = SEQD_VT_STRING;
+            vt->unknown++;
+            break;
+
+        case '7': vt->saved_row = vt->row; vt->saved_col = vt->col; vt->saved_attr = vt->attr; break;
+        case '8': seqd_vt_move(vt, vt->saved_row, vt->saved_col); vt->attr = vt->saved_attr; break;
+        case 'D': seqd_vt_index(vt); break;
+        case 'M': seqd_vt_reverse_index(vt); break;
+        case 'E': vt->col = 0; seqd_vt_index(vt); break;
+        case 'c': seqd_vt_reset(vt); break;
+
+        default:
+            if (final >= 0x20 && final <= 0x2F) {                       // Intermediate, e.g. ESC ( B - skipped up to the final byte
+                vt->state = SEQD_VT_ESCAPE_INTERMEDIATE;
+                vt->sequences--;
+                return;
+            }
+            vt->unknown++;
+            break;
+    }
+}
+
+static inline void seqd_vt_control(seqd_vt* vt, char c) {               // C0 controls, these act even in the middle of a sequence
+    switch (c) {
+        case '\r': vt->col = 0; vt->wrap_pending = false; break;
+        case '\n': case '\v': case '\f': vt->col = 0; seqd_vt_index(vt); break;
+        case '\b': seqd_vt_move(vt, vt->row, vt->col - 1); break;
+        case '\t': seqd_vt_move(vt, vt->row, (vt->col / 8 + 1) * 8); break;
+        default: break;                                                 // BEL and the rest don't change the screen
+    }
+}
+
+static inline void seqd_vt_byte(seqd_vt* vt, unsigned char c) {
+    if (c == 0x1B) {                                                    // Always starts a new sequence, whatever was being parsed is dropped
+        if (vt->state == SEQD_VT_STRING) {
+            vt->state = SEQD_VT_STRING_ESCAPE;
+        } else {
+            if (vt->state != SEQD_VT_GROUND)
+                vt->unknown++;
+            vt->state = SEQD_VT_ESCAPE;
+        }
+        vt->utf8_left = 0;
+        return;
+    }
+
+    switch (vt->state) {
+        case SEQD_VT_ESCAPE:
+            if (c < 0x20)
+                seqd_vt_control(vt, (char) c);
+            else
+                seqd_vt_escape(vt, (char) c);
+            return;
+
+        case SEQD_VT_ESCAPE_INTERMEDIATE:
+            if (c < 0x20) {
+                seqd_vt_control(vt, (char) c);
+            } else if (c >= 0x30) {
+                vt->sequences++;
+                vt->unknown++;
+                vt->state = SEQD_VT_GROUND;
+            }
+            return;
+
+        case SEQD_VT_CSI:
+            if (c >= '0' && c <= '9') {
+                if (vt->overflow)                                       // Digits of a parameter that wasn't kept
+                    return;
+                if (vt->param_count == 0)
+                    vt->params[vt->param_count++] = 0;
+                int* p = &vt->params[vt->param_count - 1];
+                if (*p < 100000)                                        // Anything bigger is nonsense anyway, this keeps it from overflowing
+                    *p = *p * 10 + (c - '0');
+            } else if (c == ';' || c == ':') {                          // Colon sub-parameters are read as plain parameters
+                if (vt->param_count == 0)
+                    vt->params[vt->param_count++] = 0;
+                if (vt->param_count < SEQD_VT_MAX_PARAMS)
+                    vt->params[vt->param_count++] = 0;
+                else
+                    vt->overflow = true;
+            } else if (c >= '<' && c <= '?') {
+                vt->marker = (char) c;
+            } else if (c >= 0x20 && c <= 0x2F) {
+                vt->intermediate = true;
+            } else if (c >= 0x40 && c <= 0x7E) {
+                vt->state = SEQD_VT_GROUND;
+                seqd_vt_csi(vt, (char) c);
+            } else if (c < 0x20) {
+                seqd_vt_control(vt, (char) c);
+            }
+            return;
+
+        case SEQD_VT_STRING:
+            if (c == 0x07)
+                vt->state = SEQD_VT_GROUND;
+            return;
+
+        case SEQD_VT_STRING_ESCAPE:                                     // ESC '\' ends the string, anything else keeps skipping
+            vt->state = c == '\\' ? SEQD_VT_GROUND : SEQD_VT_STRING;
+            return;
+
+        default:
+            break;
+    }
+
+    // Ground
+    if (vt->utf8_left > 0) {
+        if ((c & 0xC0) == 0x80) {
+            vt->utf8 = (vt->utf8 << 6) | (c & 0x3F);
+            if (--vt->utf8_left == 0)
+                seqd_vt_print(vt, vt->utf8);
+            return;
+        }
+
+        vt->utf8_left = 0;                                              // Cut short, the broken character shows as U+FFFD
+        seqd_vt_print(vt, 0xFFFD);
+    }
+
+    if (c < 0x20 || c == 0x7F) {
+        seqd_vt_control(vt, (char) c);
+    } else if (c < 0x80) {
+        seqd_vt_print(vt, c);
+    } else if (c >= 0xC2 && c <= 0xF4) {
+        vt->utf8_left = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+        vt->utf8 = c & (0x3F >> vt->utf8_left);
+    } else {
+        seqd_vt_print(vt, 0xFFFD);
+    }
+}
+
+///////////////////////////////////// Setup ///////////////////////////////////
+
+static inline bool seqd_vt_init(seqd_vt* vt, int width, int height) {
+    memset(vt, 0, sizeof(*vt));
+    if (width <= 0 || height <= 0)
+        return false;
+
+    vt->cells = (seqd_cell*) malloc((size_t) width * (size_t) height * sizeof(seqd_cell));
+    if (vt->cells == NULL)
+        return false;
+
+    vt->width = width;
+    vt->height = height;
+    seqd_vt_reset(vt);
+    return true;
+}
+
+static inline void seqd_vt_free(seqd_vt* vt) {
+    seqd_vt_record(vt, NULL);
+    free(vt->cells);
+    memset(vt, 0, sizeof(*vt));
+}
+
+static inline bool seqd_vt_copy(seqd_vt* dst, const seqd_vt* src) {
+    size_t size = (size_t) src->width * (size_t) src->height * sizeof(seqd_cell);
+    seqd_cell* cells = (seqd_cell*) realloc(dst->cells, size);
+    if (cells == NULL)
+        return false;
+
+    if (dst->record != NULL)
+        fclose(dst->record);
+
+    *dst = *src;
+    dst->cells = cells;
+    dst->record = NULL;
+    memcpy(dst->cells, src->cells, size);
+    return true;
+}
+
+static inline void seqd_vt_reset(seqd_vt* vt) {
+    vt->attr.fg = vt->attr.bg = SEQD_COLOUR_DEFAULT;
+    vt->attr.style = 0;
+    vt->saved_attr = vt->attr;
+    vt->row = vt->col = vt->saved_row = vt->saved_col = 0;
+    vt->wrap_pending = false;
+    vt->top = 0;
+    vt->bottom = vt->height - 1;
+    vt->cursor_visible = true;
+    vt->sync = false;
+    vt->state = SEQD_VT_GROUND;
+    vt->utf8_left = 0;
+
+    for (int row = 0; row < vt->height; row++)
+        seqd_vt_fill(vt, row, 0, vt->width);
+}
+
+///////////////////////////////////// Input ///////////////////////////////////
+
+static inline void seqd_vt_feed(seqd_vt* vt, const char* data, size_t size) {
+    if (vt->record != NULL)
+        fwrite(data, 1, size, vt->record);
+
+    vt->bytes += size;
+    for (size_t i = 0; i < size; i++)
+        seqd_vt_byte(vt, (unsigned char) data[i]);
+}
+
+static inline void seqd_vt_present(seqd_vt* vt, seqd_context* ctx) {
+    seqd_arena_reset(ctx);
+
+    vt->frames++;
+    vt->last_frame_bytes = ctx->size;
+    if (ctx->size > vt->max_frame_bytes)
+        vt->max_frame_bytes = ctx->size;
+
+    if (ctx->buf != NULL)
+        seqd_vt_feed(vt, ctx->buf, ctx->size);
+
+    seqd_clear(ctx);
+}
+
+/////////////////////////////////// Inspection ////////////////////////////////
+
+static inline const seqd_cell* seqd_vt_cell(const seqd_vt* vt, int row, int col) {
+    if (row < 0 || col < 0 || row >= vt->height || col >= vt->width)
+        return NULL;
+
+    return &vt->cells[row * vt->width + col];
+}
+
+static inline int seqd_vt_row_text(const seqd_vt* vt, int row, char* out, int size) {
+    int length = 0, kept = 0;                                           // kept is the length up to the last non blank
+
+    for (int col = 0; row >= 0 && row < vt->height && col < vt->width; col++) {
+        unsigned int ch = vt->cells[row * vt->width + col].ch;
+        char utf8[4];
+        int n;
+
+        if (ch == 0)                                                    // Second half of a wide character
+            continue;
+
+        n = seqd_utf8_encode(ch, utf8);
+        if (length + n >= size)
+            break;
+
+        memcpy(out + length, utf8, n);
+        length += n;
+        if (ch != ' ')
+            kept = length;
+    }
+
+    if (size > 0)
+        out[kept] = '\0';
+    return kept;
+}
+
+static inline int seqd_vt_diff(const seqd_vt* a, const seqd_vt* b, int fd) {
+    if (a->width != b->width || a->height != b->height)
+        return -1;
+
+    int differences = 0;
+
+    for (int row = 0; row < a->height; row++) {
+        int first = -1;
+
+        for (int col = 0; col < a->width; col++) {
+            if (!seqd_cell_equal(&a->cells[row * a->width + col], &b->cells[row * b->width + col])) {
+                if (first < 0)
+                    first = col;
+                differences++;
+            }
+        }
+
+        if (first < 0 || fd < 0)
+            continue;
+
+        // One line per row, "row 3 col 5: fg/bg/style of each side" then both texts
+        int size = a->width * 4 + 1;
+        char* text = (char*) malloc((size_t) size);
+        if (text == NULL)
+            continue;
+
+        const seqd_cell* x = &a->cells[row * a->width + first];
+        const seqd_cell* y = &b->cells[row * b->width + first];
+        char line[192];
+        int n = snprintf(line, sizeof(line), "row %d col %d: U+%04X %08X/%08X/%02X | U+%04X %08X/%08X/%02X\n", row, first,
+            x->ch, x->attr.fg, x->attr.bg, x->attr.style, y->ch, y->attr.fg, y->attr.bg, y->attr.style);
+        write_all(fd, line, (size_t) n);
+
+        const seqd_vt* sides[2] = { a, b };
+        for (int i = 0; i < 2; i++) {
+            write_all(fd, i == 0 ? "  < " : "  > ", 4);
+            write_all(fd, text, (size_t) seqd_vt_row_text(sides[i], row, text, size));
+            write_all(fd, "\n", 1);
+        }
+
+        free(text);
+    }
+
+    return differences;
+}
+
+static inline bool seqd_vt_dump(const seqd_vt* vt, int fd) {
+    int size = vt->width * 4 + 2;
+    char* text = (char*) malloc((size_t) size);
+    bool ok = text != NULL;
+
+    for (int row = 0; ok && row < vt->height; row++) {
+        int n = seqd_vt_row_text(vt, row, text, size);
+        text[n++] = '\n';
+        ok = write_all(fd, text, (size_t) n);
+    }
+
+    if (ok) {
+        char line[64];
+        int n = snprintf(line, sizeof(line), "cursor %d,%d%s\n", vt->row, vt->col, vt->cursor_visible ? "" : " hidden");
+        ok = write_all(fd, line, (size_t) n);
+    }
+
+    free(text);
+    return ok;
+}
+
+/////////////////////////////////// Recording /////////////////////////////////
+
+static inline bool seqd_vt_record(seqd_vt* vt, const char* path) {
+    if (vt->record != NULL) {
+        fclose(vt->record);
+        vt->record = NULL;
+    }
+
+    if (path == NULL)
+        return true;
+
+    vt->record = fopen(path, "wb");
+    return vt->record != NULL;
+}
+
+static inline long long seqd_vt_replay(seqd_vt* vt, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return -1;
+
+    char* chunk = (char*) malloc(SEQD_VT_REPLAY_CHUNK);
+    if (chunk == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    long long total = 0;
+    size_t n;
+
+    while ((n = fread(chunk, 1, SEQD_VT_REPLAY_CHUNK, file)) > 0) {
+        seqd_vt_feed(vt, chunk, n);
+        total += (long long) n;
+    }
+
+    bool failed = ferror(file) != 0;
+    free(chunk);
+    fclose(file);
+    return failed ? -1 : total;
+}
+
+#endif
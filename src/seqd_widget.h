@@ -0,0 +1,511 @@
+// Seqd widget - header-only extension to seqd.h
+// A small retained layer of boxes, labels, lists and progress bars, each laid
+// out in a rectangle. Changing a widget marks it dirty, and a render only
+// redraws the rectangles of the widgets that changed since the last one.
+
+#ifndef SEQD_WIDGET_H
+#define SEQD_WIDGET_H
+
+///////////////////////////////// Dependencies ////////////////////////////////
+#include "seqd.h"
+
+///////////////////////////////////// Docs ////////////////////////////////////
+// Rows and columns are 0 based, like seqd_screen.h. Widgets are known by    //
+// the id their constructor returns, which stays the same as more are added. //
+//                                                                           //
+// Widgets shouldn't overlap, with one exception: a box only draws its       //
+// border, so other widgets can sit inside it (seqd_rect_inset(box, 1)).     //
+// Setters that don't change what a widget looks like don't dirty it, so     //
+// calling them every tick with the same values costs next to nothing.       //
+//                                                                           //
+// Label text is copied, list items are not - call seqd_ui_set_items again   //
+// (or seqd_ui_invalidate) after changing them.                              //
+///////////////////////////////////////////////////////////////////////////////
+
+// Constants
+#define SEQD_WIDGET_BOX         1                                       // Border with an optional title in the top edge
+#define SEQD_WIDGET_LABEL       2                                       // Text, one row per line, clipped and padded to the rectangle
+#define SEQD_WIDGET_LIST        3                                       // Scrollable list of items with one selected
+#define SEQD_WIDGET_PROGRESS    4                                       // Horizontal bar, drawn in eighths of a cell
+
+// Types
+typedef struct seqd_rect {
+    int row;
+    int col;
+    int width;
+    int height;
+} seqd_rect;
+
+typedef struct seqd_widget {
+    int kind;                                                           // A SEQD_WIDGET_ value
+    seqd_rect rect;
+    seqd_attr attr;
+    bool dirty;                                                         // Queued for the next render
+
+    char* text;                                                         // Label text or box title, owned by the widget
+
+    const char** items;                                                 // List items, not owned
+    int item_count;
+    int top;                                                            // First item shown
+    int selected;                                                       // -1 for none
+    seqd_attr selected_attr;
+
+    int filled;                                                         // Progress bar length in eighths of a cell
+} seqd_widget;
+
+typedef struct seqd_ui {
+    seqd_widget* widgets;
+    int count;
+    int capacity;
+    int* dirty;                                                         // Ids in the order they were invalidated, each at most once
+    int dirty_count;
+    seqd_context* ctx;                                                  // Where renders are queued, seqdctx unless set otherwise
+} seqd_ui;
+
+// Layout
+static inline seqd_rect seqd_rect_make(int row, int col, int width, int height);
+static inline seqd_rect seqd_rect_inset(seqd_rect r, int n);            // Shrinks r by n cells on every side
+static inline seqd_rect seqd_rect_take_top(seqd_rect* r, int rows);     // Cuts rows off the top of r and returns them
+static inline seqd_rect seqd_rect_take_left(seqd_rect* r, int cols);    // Cuts cols off the left of r and returns them
+
+// Setup
+static inline void seqd_ui_init(seqd_ui* ui);
+static inline void seqd_ui_free(seqd_ui* ui);                           // Frees every widget, ids are no longer valid
+static inline seqd_widget* seqd_ui_widget(seqd_ui* ui, int id);         // NULL for an unknown id, changing fields by hand needs seqd_ui_invalidate
+
+// Widgets (each returns its id, -1 on failure)
+static inline int seqd_ui_box(seqd_ui* ui, seqd_rect rect, const char* title);
+static inline int seqd_ui_label(seqd_ui* ui, seqd_rect rect, const char* text);
+static inline int seqd_ui_list(seqd_ui* ui, seqd_rect rect, const char** items, int count);
+static inline int seqd_ui_progress(seqd_ui* ui, seqd_rect rect, double value);
+
+// Changes (only dirty the widget if it will look different)
+static inline void seqd_ui_set_text(seqd_ui* ui, int id, const char* text);     // Label text or box title
+static inline void seqd_ui_set_attr(seqd_ui* ui, int id, seqd_attr attr);
+static inline void seqd_ui_set_items(seqd_ui* ui, int id, const char** items, int count);
+static inline void seqd_ui_select(seqd_ui* ui, int id, int index);      // Selects a list item and scrolls to it, -1 for none
+static inline void seqd_ui_scroll(seqd_ui* ui, int id, int rows);       // Scrolls a list by rows, negative is up
+static inline void seqd_ui_set_progress(seqd_ui* ui, int id, double value); // 0 to 1
+static inline void seqd_ui_move(seqd_ui* ui, int id, seqd_rect rect);   // Blanks the old rectangle and draws in the new one, widgets the blanking covered are drawn again
+
+// Output
+static inline void seqd_ui_invalidate(seqd_ui* ui, int id);             // Redraw the widget on the next render
+static inline void seqd_ui_invalidate_all(seqd_ui* ui);                 // Redraw everything, e.g. after the terminal was cleared
+static inline int seqd_ui_render(seqd_ui* ui);                          // Queues the dirty widgets into ui->ctx, returns how many were drawn
+static inline int seqd_ui_present(seqd_ui* ui);                         // seqd_ui_render, then displays and clears ui->ctx if anything was drawn
+
+////////////////////////////// Utility functions //////////////////////////////
+
+static inline seqd_rect seqd_rect_make(int row, int col, int width, int height) {
+    seqd_rect r = { row, col, width, height };
+    return r;
+}
+
+static inline seqd_rect seqd_rect_inset(seqd_rect r, int n) {
+    r.row += n;
+    r.col += n;
+    r.width = r.width > 2 * n ? r.width - 2 * n : 0;
+    r.height = r.height > 2 * n ? r.height - 2 * n : 0;
+    return r;
+}
+
+static inline seqd_rect seqd_rect_take_top(seqd_rect* r, int rows) {
+    if (rows > r->height)
+        rows = r->height;
+
+    seqd_rect top = { r->row, r->col, r->width, rows };
+    r->row += rows;
+    r->height -= rows;
+    return top;
+}
+
+static inline seqd_rect seqd_rect_take_left(seqd_rect* r, int cols) {
+    if (cols > r->width)
+        cols = r->width;
+
+    seqd_rect left = { r->row, r->col, cols, r->height };
+    r->col += cols;
+    r->width -= cols;
+    return left;
+}
+
+static inline bool seqd_rect_equal(seqd_rect a, seqd_rect b) {
+    return a.row == b.row && a.col == b.col && a.width == b.width && a.height == b.height;
+}
+
+static inline bool seqd_rect_overlaps(seqd_rect a, seqd_rect b) {
+    return a.width > 0 && a.height > 0 && b.width > 0 && b.height > 0 &&
+        a.row < b.row + b.height && b.row < a.row + a.height && a.col < b.col + b.width && b.col < a.col + a.width;
+}
+
+static inline bool seqd_rect_contains(seqd_rect outer, seqd_rect inner) {
+    return inner.row >= outer.row && inner.col >= outer.col &&
+        inner.row + inner.height <= outer.row + outer.height && inner.col + inner.width <= outer.col + outer.width;
+}
+
+static inline bool seqd_attr_equal(seqd_attr a, seqd_attr b) {
+    return a.fg == b.fg && a.bg == b.bg && a.style == b.style;
+}
+
+static inline void seqd_ui_repeat(seqd_context* ctx, const char* utf8, int times) { // Queues utf8 times times
+    unsigned int length = (unsigned int) strlen(utf8);
+
+    for (int i = 0; i < times; i++)
+        seqd_buffer_n(ctx, utf8, length);
+}
+
+static inline int seqd_ui_add(seqd_ui* ui, int kind, seqd_rect rect) {  // New dirty widget with default attributes
+    if (ui->count == ui->capacity) {
+        int capacity = ui->capacity ? ui->capacity * 2 : 16;
+
+        seqd_widget* widgets = (seqd_widget*) realloc(ui->widgets, capacity * sizeof(seqd_widget));
+        if (widgets == NULL)
+            return -1;
+        ui->widgets = widgets;
+
+        int* dirty = (int*) realloc(ui->dirty, capacity * sizeof(int));
+        if (dirty == NULL)
+            return -1;
+        ui->dirty = dirty;
+
+        ui->capacity = capacity;
+    }
+
+    seqd_widget* w = &ui->widgets[ui->count];
+    memset(w, 0, sizeof(*w));
+    w->kind = kind;
+    w->rect = rect;
+    w->selected = -1;
+    w->attr.fg = w->attr.bg = SEQD_COLOUR_DEFAULT;
+    w->selected_attr.style = SEQD_STYLE_REVERSE;
+
+    int id = ui->count++;
+    seqd_ui_invalidate(ui, id);
+    return id;
+}
+
+static inline void seqd_ui_blank(seqd_ui* ui, seqd_rect r) {            // Queues spaces over r in the default attributes
+    seqd_attr plain = { SEQD_COLOUR_DEFAULT, SEQD_COLOUR_DEFAULT, 0 };
+    seqd_sgr_set(ui->ctx, plain);
+    seqd_sgr_flush(ui->ctx);
+
+    for (int row = 0; row < r.height; row++) {
+        seqd_setcur(ui->ctx, r.row + row + 1, r.col + 1);
+        seqd_text(ui->ctx, "", 0, r.width);
+    }
+}
+
+///////////////////////////////////// Setup ///////////////////////////////////
+
+static inline void seqd_ui_init(seqd_ui* ui) {
+    memset(ui, 0, sizeof(*ui));
+    ui->ctx = &seqdctx;
+}
+
+static inline void seqd_ui_free(seqd_ui* ui) {
+    for (int i = 0; i < ui->count; i++)
+        free(ui->widgets[i].text);
+
+    free(ui->widgets);
+    free(ui->dirty);
+    memset(ui, 0, sizeof(*ui));
+}
+
+static inline seqd_widget* seqd_ui_widget(seqd_ui* ui, int id) {
+    if (id < 0 || id >= ui->count)
+        return NULL;
+
+    return &ui->widgets[id];
+}
+
+//////////////////////////////////// Widgets //////////////////////////////////
+
+static inline int seqd_ui_box(seqd_ui* ui, seqd_rect rect, const char* title) {
+    int id = seqd_ui_add(ui, SEQD_WIDGET_BOX, rect);
+    seqd_ui_set_text(ui, id, title);
+    return id;
+}
+
+static inline int seqd_ui_label(seqd_ui* ui, seqd_rect rect, const char* text) {
+    int id = seqd_ui_add(ui, SEQD_WIDGET_LABEL, rect);
+    seqd_ui_set_text(ui, id, text);
+    return id;
+}
+
+static inline int seqd_ui_list(seqd_ui* ui, seqd_rect rect, const char** items, int count) {
+    int id = seqd_ui_add(ui, SEQD_WIDGET_LIST, rect);
+    seqd_ui_set_items(ui, id, items, count);
+    return id;
+}
+
+static inline int seqd_ui_progress(seqd_ui* ui, seqd_rect rect, double value) {
+    int id = seqd_ui_add(ui, SEQD_WIDGET_PROGRESS, rect);
+    seqd_ui_set_progress(ui, id, value);
+    return id;
+}
+
+//////////////////////////////////// Changes //////////////////////////////////
+
+static inline void seqd_ui_set_text(seqd_ui* ui, int id, const char* text) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL)
+        return;
+
+    if (text == NULL)
+        text = "";
+
+    if (w->text != NULL && strcmp(w->text, text) == 0)
+        return;
+
+    size_t size = strlen(text) + 1;
+    char* copy = (char*) realloc(w->text, size);
+    if (copy == NULL)
+        return;
+
+    memcpy(copy, text, size);
+    w->text = copy;
+    seqd_ui_invalidate(ui, id);
+}
+
+static inline void seqd_ui_set_attr(seqd_ui* ui, int id, seqd_attr attr) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL || seqd_attr_equal(w->attr, attr))
+        return;
+
+    w->attr = attr;
+    seqd_ui_invalidate(ui, id);
+}
+
+static inline void seqd_ui_set_items(seqd_ui* ui, int id, const char** items, int count) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL)
+        return;
+
+    w->items = items;
+    w->item_count = count;
+
+    if (w->selected >= count)
+        w->selected = count - 1;
+    if (w->top > count - w->rect.height)
+        w->top = count - w->rect.height;
+    if (w->top < 0)
+        w->top = 0;
+
+    seqd_ui_invalidate(ui, id);                                         // The items themselves may have changed
+}
+
+static inline void seqd_ui_select(seqd_ui* ui, int id, int index) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL)
+        return;
+
+    if (index >= w->item_count)
+        index = w->item_count - 1;
+    if (index < -1)
+        index = -1;
+
+    int top = w->top;
+    if (index >= 0 && index < top)
+        top = index;
+    if (index >= top + w->rect.height)
+        top = index - w->rect.height + 1;
+
+    if (index == w->selected && top == w->top)
+        return;
+
+    w->selected = index;
+    w->top = top;
+    seqd_ui_invalidate(ui, id);
+}
+
+static inline void seqd_ui_scroll(seqd_ui* ui, int id, int rows) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL)
+        return;
+
+    int top = w->top + rows;
+    if (top > w->item_count - w->rect.height)
+        top = w->item_count - w->rect.height;
+    if (top < 0)
+        top = 0;
+
+    if (top == w->top)
+        return;
+
+    w->top = top;
+    seqd_ui_invalidate(ui, id);
+}
+
+static inline void seqd_ui_set_progress(seqd_ui* ui, int id, double value) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL)
+        return;
+
+    if (value < 0)
+        value = 0;
+    if (value > 1)
+        value = 1;
+
+    int filled = (int) (value * w->rect.width * 8 + 0.5);
+    if (filled == w->filled)
+        return;
+
+    w->filled = filled;
+    seqd_ui_invalidate(ui, id);
+}
+
+static inline void seqd_ui_move(seqd_ui* ui, int id, seqd_rect rect) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL || seqd_rect_equal(w->rect, rect))
+        return;
+
+    seqd_ui_blank(ui, w->rect);
+
+    // The blanking also wiped whatever sat in the old rectangle, like the widgets inside a box
+    for (int i = 0; i < ui->count; i++) {
+        const seqd_widget* other = &ui->widgets[i];
+        bool inside_border = other->kind == SEQD_WIDGET_BOX && seqd_rect_contains(seqd_rect_inset(other->rect, 1), w->rect);
+
+        if (i != id && seqd_rect_overlaps(other->rect, w->rect) && !inside_border)
+            seqd_ui_invalidate(ui, i);
+    }
+
+    if (w->kind == SEQD_WIDGET_PROGRESS && w->rect.width > 0)           // Keep the same fraction filled
+        w->filled = (int) ((long) w->filled * rect.width / w->rect.width);
+
+    w->rect = rect;
+    seqd_ui_invalidate(ui, id);
+}
+
+///////////////////////////////////// Drawing /////////////////////////////////
+
+static inline void seqd_ui_draw_box(seqd_ui* ui, const seqd_widget* w) {
+    seqd_rect r = w->rect;
+    if (r.width < 2 || r.height < 2)
+        return;
+
+    // Top edge, with the title set into it
+    seqd_setcur(ui->ctx, r.row + 1, r.col + 1);
+    seqd_buffer(ui->ctx, "\xe2\x94\x8c");                               // ┌
+
+    int inner = r.width - 2;
+    if (w->text != NULL && w->text[0] != '\0' && inner > 2) {
+        int used = 0;
+        size_t fit = text_fit(w->text, strlen(w->text), inner - 2, &used);
+
+        seqd_buffer(ui->ctx, " ");
+        seqd_buffer_n(ui->ctx, w->text, (unsigned int) fit);
+        seqd_buffer(ui->ctx, " ");
+        inner -= used + 2;
+    }
+
+    seqd_ui_repeat(ui->ctx, "\xe2\x94\x80", inner);                     // ─
+    seqd_buffer(ui->ctx, "\xe2\x94\x90");                               // ┐
+
+    // Sides only, the inside belongs to other widgets
+    for (int row = 1; row < r.height - 1; row++) {
+        seqd_setcur(ui->ctx, r.row + row + 1, r.col + 1);
+        seqd_buffer(ui->ctx, "\xe2\x94\x82");                           // │
+        seqd_setcur(ui->ctx, r.row + row + 1, r.col + r.width);
+        seqd_buffer(ui->ctx, "\xe2\x94\x82");
+    }
+
+    seqd_setcur(ui->ctx, r.row + r.height, r.col + 1);
+    seqd_buffer(ui->ctx, "\xe2\x94\x94");                               // └
+    seqd_ui_repeat(ui->ctx, "\xe2\x94\x80", r.width - 2);
+    seqd_buffer(ui->ctx, "\xe2\x94\x98");                               // ┘
+}
+
+static inline void seqd_ui_draw_label(seqd_ui* ui, const seqd_widget* w) {
+    const char* line = w->text;
+
+    for (int row = 0; row < w->rect.height; row++) {
+        const char* end = line ? strchr(line, '\n') : NULL;
+        size_t length = line == NULL ? 0 : end ? (size_t) (end - line) : strlen(line);
+
+        seqd_setcur(ui->ctx, w->rect.row + row + 1, w->rect.col + 1);
+        seqd_text(ui->ctx, line ? line : "", length, w->rect.width);
+
+        line = end ? end + 1 : NULL;
+    }
+}
+
+static inline void seqd_ui_draw_list(seqd_ui* ui, const seqd_widget* w) {
+    for (int row = 0; row < w->rect.height; row++) {
+        int index = w->top + row;
+        const char* item = index < w->item_count && w->items[index] ? w->items[index] : "";
+
+        seqd_sgr_set(ui->ctx, index == w->selected ? w->selected_attr : w->attr);
+        seqd_sgr_flush(ui->ctx);
+
+        seqd_setcur(ui->ctx, w->rect.row + row + 1, w->rect.col + 1);
+        seqd_text(ui->ctx, item, strlen(item), w->rect.width);
+    }
+}
+
+static inline void seqd_ui_draw_progress(seqd_ui* ui, const seqd_widget* w) {
+    static const char* eighths[] = { "", "\xe2\x96\x8f", "\xe2\x96\x8e", "\xe2\x96\x8d", "\xe2\x96\x8c", "\xe2\x96\x8b", "\xe2\x96\x8a", "\xe2\x96\x89" }; // ▏ to ▉
+    int full = w->filled / 8;
+    int part = w->filled % 8;
+
+    for (int row = 0; row < w->rect.height; row++) {
+        seqd_setcur(ui->ctx, w->rect.row + row + 1, w->rect.col + 1);
+        seqd_ui_repeat(ui->ctx, "\xe2\x96\x88", full);                  // █
+
+        if (part > 0)
+            seqd_buffer(ui->ctx, eighths[part]);
+
+        seqd_text(ui->ctx, "", 0, w->rect.width - full - (part > 0));
+    }
+}
+
+///////////////////////////////////// Output //////////////////////////////////
+
+static inline void seqd_ui_invalidate(seqd_ui* ui, int id) {
+    seqd_widget* w = seqd_ui_widget(ui, id);
+    if (w == NULL || w->dirty)
+        return;
+
+    w->dirty = true;
+    ui->dirty[ui->dirty_count++] = id;                                  // Has room for every widget, and each is only in it once
+}
+
+static inline void seqd_ui_invalidate_all(seqd_ui* ui) {
+    for (int i = 0; i < ui->count; i++)
+        seqd_ui_invalidate(ui, i);
+}
+
+static inline int seqd_ui_render(seqd_ui* ui) {
+    int drawn = ui->dirty_count;
+
+    for (int i = 0; i < ui->dirty_count; i++) {
+        seqd_widget* w = &ui->widgets[ui->dirty[i]];
+        w->dirty = false;
+
+        seqd_sgr_set(ui->ctx, w->attr);
+        seqd_sgr_flush(ui->ctx);
+
+        switch (w->kind) {
+            case SEQD_WIDGET_BOX:       seqd_ui_draw_box(ui, w);        break;
+            case SEQD_WIDGET_LABEL:     seqd_ui_draw_label(ui, w);      break;
+            case SEQD_WIDGET_LIST:      seqd_ui_draw_list(ui, w);       break;
+            case SEQD_WIDGET_PROGRESS:  seqd_ui_draw_progress(ui, w);   break;
+        }
+    }
+
+    ui->dirty_count = 0;
+    return drawn;
+}
+
+static inline int seqd_ui_present(seqd_ui* ui) {
+    int drawn = seqd_ui_render(ui);
+
+    if (drawn > 0 || ui->ctx->size > 0) {                               // seqd_ui_move can queue blanking on its own
+        seqd_display(ui->ctx);
+        seqd_clear(ui->ctx);
+    }
+
+    return drawn;
+}
+
+#endif
@@ -0,0 +1,90 @@
+// Seqd test - key decoding
+// Runs decode_key over a table of byte strings terminals send: plain and
+// UTF-8 keys, NUL, Alt + key, CSI and SS3 keys with and without modifiers,
+// sequences cut short and sequences too long for the key table. Every entry
+// is decoded as if more bytes could still arrive, then as if the timeout ran
+// out, and each result must match exactly.
+//
+// Build and run from the repository root:
+//     cc -O2 -o keys test/keys.c && ./keys
+
+#include "../src/seqd.h"
+
+#define BYTES(s) s, sizeof(s) - 1                                       // Counts the bytes itself, some entries hold NUL
+
+static const struct {
+    const char* bytes;
+    int length;
+    int waiting_used;                                                   // decode_key with complete false
+    int used;                                                           // decode_key with complete true
+    int code;
+    unsigned int mods;
+} cases[] = {
+    // Plain keys and UTF-8
+    { BYTES("a"),                        1,  1, 'a',                    0 },
+    { BYTES("\t"),                       1,  1, SEQD_KEY_TAB,           0 },
+    { BYTES("\x7f"),                     1,  1, SEQD_KEY_BACKSPACE,     0 },
+    { BYTES("\xe4\xb8\xad"),             3,  3, 0x4E2D,                 0 },
+    { BYTES("\xf0\x9f\x98\x80!"),        4,  4, 0x1F600,                0 },
+    { BYTES("\xe4\xb8"),                 0,  1, 0xFFFD,                 0 },
+    { BYTES("\xb8x"),                    1,  1, 0xFFFD,                 0 },
+    { BYTES("\0"),                       1,  1, ' ',                    SEQD_MOD_CTRL },
+    { BYTES("\0a"),                      1,  1, ' ',                    SEQD_MOD_CTRL },
+
+    // Escape and Alt + key
+    { BYTES("\033"),                     0,  1, SEQD_KEY_ESC,           0 },
+    { BYTES("\033a"),                    2,  2, 'a',                    SEQD_MOD_ALT },
+    { BYTES("\033\xe4\xb8\xad"),         4,  4, 0x4E2D,                 SEQD_MOD_ALT },
+    { BYTES("\033\0"),                   2,  2, ' ',                    SEQD_MOD_ALT | SEQD_MOD_CTRL },
+    { BYTES("\033["),                    0,  2, '[',                    SEQD_MOD_ALT },
+    { BYTES("\033O"),                    0,  2, 'O',                    SEQD_MOD_ALT },
+
+    // CSI and SS3 keys
+    { BYTES("\033[A"),                   3,  3, SEQD_KEYCODE_UP,        0 },
+    { BYTES("\033OA"),                   3,  3, SEQD_KEYCODE_UP,        0 },
+    { BYTES("\033OP"),                   3,  3, SEQD_KEYCODE_F(1),      0 },
+    { BYTES("\033[3~"),                  4,  4, SEQD_KEYCODE_DELETE,    0 },
+    { BYTES("\033[24~"),                 5,  5, SEQD_KEYCODE_F(12),     0 },
+    { BYTES("\033[Z"),                   3,  3, SEQD_KEY_TAB,           SEQD_MOD_SHIFT },
+    { BYTES("\033[A\033[B"),             3,  3, SEQD_KEYCODE_UP,        0 },
+
+    // Modifiers
+    { BYTES("\033[1;5A"),                6,  6, SEQD_KEYCODE_UP,        SEQD_MOD_CTRL },
+    { BYTES("\033[1;3D"),                6,  6, SEQD_KEYCODE_LEFT,      SEQD_MOD_ALT },
+    { BYTES("\033[1;8C"),                6,  6, SEQD_KEYCODE_RIGHT,     SEQD_MOD_SHIFT | SEQD_MOD_ALT | SEQD_MOD_CTRL },
+    { BYTES("\033[3;2~"),                6,  6, SEQD_KEYCODE_DELETE,    SEQD_MOD_SHIFT },
+    { BYTES("\033[1;5~"),                6,  6, SEQD_KEYCODE_HOME,      SEQD_MOD_CTRL },
+    { BYTES("\033[15;6~"),               7,  7, SEQD_KEYCODE_F(5),      SEQD_MOD_SHIFT | SEQD_MOD_CTRL },
+
+    // Cut short, unknown and too long to look up
+    { BYTES("\033[1;5"),                 0,  5, SEQD_KEYCODE_UNKNOWN,   0 },
+    { BYTES("\033[1;5\033[A"),           5,  5, SEQD_KEYCODE_UNKNOWN,   0 },
+    { BYTES("\033[99~"),                 5,  5, SEQD_KEYCODE_UNKNOWN,   0 },
+    { BYTES("\033[<0;10;5M"),           10, 10, SEQD_KEYCODE_UNKNOWN,   0 },
+    { BYTES("\033[<35;200;100;11;12mx"),20, 20, SEQD_KEYCODE_UNKNOWN,   0 },
+    { BYTES("\033[12345678901234567890~"), 23, 23, SEQD_KEYCODE_UNKNOWN, 0 },
+};
+
+int main() {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        for (int complete = 0; complete <= 1; complete++) {
+            seqd_key key = { 0, 0 };
+            int used = decode_key(cases[i].bytes, cases[i].length, complete, &key);
+            int expected = complete ? cases[i].used : cases[i].waiting_used;
+
+            if (used != expected || (used != 0 && (key.code != cases[i].code || key.mods != cases[i].mods))) {
+                fprintf(stderr, "keys: entry %zu (%s): used %d, U+%04X mods %u, expected %d, U+%04X mods %u\n",
+                    i, complete ? "complete" : "waiting", used, key.code, key.mods, expected, cases[i].code, cases[i].mods);
+                failed = 1;
+            }
+        }
+    }
+
+    if (!failed)
+        printf("keys: %zu sequences ok\n", sizeof(cases) / sizeof(cases[0]));
+
+    deinit();
+    return failed;
+}
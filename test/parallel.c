@@ -0,0 +1,65 @@
+// Seqd test - parallel segment rendering
+// Renders many frames on a seqd_pool and checks each one against the same
+// segments formatted one after another. Meant to be run under ThreadSanitizer,
+// which reports any frame state shared with the workers without the lock.
+//
+// Build and run from the repository root:
+//     cc -g -O1 -fsanitize=thread -o parallel test/parallel.c -pthread && ./parallel
+
+#include "../src/seqd.h"
+#include "../src/seqd_parallel.h"
+
+#define FRAMES 2000
+#define MAX_SEGMENTS 24
+
+static void segment(seqd_context* ctx, int index, void* user) {
+    int frame = *(int*) user;
+
+    seqd_setcur(ctx, index + 1, 1);
+    seqd_sgr_fg(ctx, SEQD_COLOUR_256(frame + index));
+    seqd_sgr_flush(ctx);
+    seqd_buffer(ctx, seqd_format(ctx, "segment %d of frame %d", index, frame));
+}
+
+int main() {
+    seqd_pool pool;
+    seqd_context out = { 0 };
+    seqd_context expected = { 0 };
+    seqd_context one = { 0 };
+
+    if (!seqd_pool_init(&pool, 4)) {
+        fprintf(stderr, "seqd_pool_init failed\n");
+        return 1;
+    }
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        int count = 1 + frame % MAX_SEGMENTS;                           // Changing the count every frame also grows the contexts while the workers are parked
+
+        seqd_clear(&out);
+        if (!seqd_pool_render(&pool, &out, count, segment, &frame)) {
+            fprintf(stderr, "frame %d: seqd_pool_render failed\n", frame);
+            return 1;
+        }
+
+        seqd_clear(&expected);
+        for (int i = 0; i < count; i++) {
+            seqd_clear(&one);
+            seqd_arena_reset(&one);
+            seqd_sgr_invalidate(&one);
+            segment(&one, i, &frame);
+            seqd_append(&expected, &one);
+        }
+
+        if (out.size != expected.size || memcmp(out.buf, expected.buf, out.size) != 0) {
+            fprintf(stderr, "frame %d: %zu bytes, expected %zu\n", frame, (size_t) out.size, (size_t) expected.size);
+            return 1;
+        }
+    }
+
+    seqd_pool_free(&pool);
+    seqd_context_free(&out);
+    seqd_context_free(&expected);
+    seqd_context_free(&one);
+    printf("parallel: %d frames ok\n", FRAMES);
+    return 0;
+}
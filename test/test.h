@@ -0,0 +1,16 @@
+// Seqd tests - shared helpers
+// Included by the programs in test/ after the seqd headers they use.
+
+#ifndef SEQD_TEST_H
+#define SEQD_TEST_H
+
+static unsigned int seed = 2463534242u;                                 // Set it back to replay the same numbers
+
+static unsigned int next_random() {                                     // xorshift32, the same numbers every run
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+#endif
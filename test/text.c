@@ -0,0 +1,150 @@
+// Seqd test - text measurement
+// Checks char_width, text_width and text_fit on a few strings with known
+// widths, then text_fit and text_width against a plain one codepoint at a
+// time version, on random strings that mix ASCII runs of every length with
+// control bytes, multibyte, wide and zero width characters and malformed UTF-8.
+//
+// Build and run from the repository root, once for each vector path since it
+// is picked at compile time:
+//     cc -O2 -o text test/text.c && ./text                    (SSE2)
+//     cc -O2 -mavx2 -o text test/text.c && ./text             (AVX2)
+//     cc -O2 -DSEQD_NO_SIMD -o text test/text.c && ./text     (scalar)
+
+#include "../src/seqd.h"
+#include "test.h"
+
+#define STRINGS 200000
+#define MAX_SIZE 200
+
+static const struct { const char* text; int width; } widths[] = {     // Widths written out, not worked out with char_width
+    { "a",                           1 },
+    { "hello",                       5 },
+    { "\xc3\xa9",                    1 },                               // e with an acute accent, precomposed
+    { "e\xcc\x81",                   1 },                               // e and U+0301 combining acute
+    { "\xcc\x81",                    0 },
+    { "\xe4\xb8\xad",                2 },                               // CJK
+    { "\xe4\xb8\xad\xe6\x96\x87",    4 },
+    { "\xf0\x9f\x98\x80",            2 },                               // Emoji
+    { "\t",                          0 },                               // Control characters
+    { "\x7f",                        0 },
+    { "a\xe4\xb8\xad!",              4 },
+};
+
+static const struct { const char* text; int columns; size_t fit; int used; } fits[] = { // Wide characters are never split
+    { "\xe4\xb8\xad\xe4\xb8\xad",    3, 3, 2 },
+    { "\xe4\xb8\xad\xe4\xb8\xad",    1, 0, 0 },
+    { "a\xe4\xb8\xad",               2, 1, 1 },
+    { "a\xf0\x9f\x98\x80" "b",       2, 1, 1 },
+    { "ab\xe4\xb8\xad",              3, 2, 2 },
+    { "ab\xe4\xb8\xad",              4, 5, 4 },
+    { "e\xcc\x81x",                  1, 3, 1 },                         // The combining mark stays with its letter
+};
+
+static int fixed_strings() {
+    if (char_width('a') != 1 || char_width(0x4E2D) != 2 || char_width(0x1F600) != 2 || char_width(0x0301) != 0 || char_width('\n') != 0) {
+        fprintf(stderr, "text: char_width gave a=%d U+4E2D=%d U+1F600=%d U+0301=%d \\n=%d, expected 1 2 2 0 0\n",
+            char_width('a'), char_width(0x4E2D), char_width(0x1F600), char_width(0x0301), char_width('\n'));
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+        int width = text_width(widths[i].text, strlen(widths[i].text));
+        if (width != widths[i].width) {
+            fprintf(stderr, "text: width %zu gave %d, expected %d\n", i, width, widths[i].width);
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(fits) / sizeof(fits[0]); i++) {
+        int used;
+        size_t fit = text_fit(fits[i].text, strlen(fits[i].text), fits[i].columns, &used);
+        if (fit != fits[i].fit || used != fits[i].used) {
+            fprintf(stderr, "text: fit %zu gave %zu bytes/%d columns, expected %zu/%d\n", i, fit, used, fits[i].fit, fits[i].used);
+            return 1;
+        }
+    }
+
+    printf("text: %zu fixed strings ok\n", sizeof(widths) / sizeof(widths[0]) + sizeof(fits) / sizeof(fits[0]));
+    return 0;
+}
+
+static size_t reference_fit(const char* utf8, size_t size, int columns, int* used) {
+    size_t i = 0;
+    int width = 0;
+
+    while (i < size) {
+        seqd_key key;
+        int length = decode_utf8_key(utf8 + i, (int) (size - i < 4 ? size - i : 4), true, &key);
+        int cw = char_width((unsigned int) key.code);
+
+        if (width + cw > columns)
+            break;
+
+        i += length;
+        width += cw;
+    }
+
+    *used = width;
+    return i;
+}
+
+static size_t random_text(char* out) {
+    static const char* pieces[] = { "\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80", "\xcc\x81", "\t", "\033[1m", "\x7f", "\x80", "\xe4\xb8", "\xff" };
+    size_t size = 0;
+    size_t target = next_random() % MAX_SIZE;
+
+    while (size < target) {
+        if (next_random() % 4 != 0) {                                   // Mostly ASCII runs, long enough to cross whole vectors
+            size_t run = next_random() % 70;
+            for (size_t i = 0; i < run && size < MAX_SIZE; i++)
+                out[size++] = (char) (0x20 + next_random() % 0x5F);
+        } else {
+            const char* piece = pieces[next_random() % (sizeof(pieces) / sizeof(pieces[0]))];
+            size_t length = strlen(piece);
+            if (size + length > MAX_SIZE)
+                break;
+
+            memcpy(out + size, piece, length);
+            size += length;
+        }
+    }
+
+    return size;
+}
+
+int main() {
+    char text[MAX_SIZE + 1];
+
+    #ifdef SEQD_SIMD_WIDTH
+        printf("text: %d byte vectors\n", SEQD_SIMD_WIDTH);
+    #else
+        printf("text: scalar\n");
+    #endif
+
+    if (fixed_strings())
+        return 1;
+
+    for (int n = 0; n < STRINGS; n++) {
+        size_t size = random_text(text);
+        int columns = (int) (next_random() % (MAX_SIZE + 10));
+        int used, expected_used;
+
+        size_t fit = text_fit(text, size, columns, &used);
+        size_t expected = reference_fit(text, size, columns, &expected_used);
+
+        if (fit != expected || used != expected_used) {
+            fprintf(stderr, "string %d (%zu bytes, %d columns): text_fit gave %zu bytes/%d columns, expected %zu/%d\n",
+                n, size, columns, fit, used, expected, expected_used);
+            return 1;
+        }
+
+        reference_fit(text, size, 0x7FFFFFFF, &expected_used);
+        if (text_width(text, size) != expected_used) {
+            fprintf(stderr, "string %d: text_width gave %d, expected %d\n", n, text_width(text, size), expected_used);
+            return 1;
+        }
+    }
+
+    printf("text: %d strings ok\n", STRINGS);
+    return 0;
+}
@@ -0,0 +1,176 @@
+// Seqd test - headless terminal
+// Cross-checks seqd_vt against seqd's own renderers:
+//   - random seqd_screen frames (every style, 256 and RGB colours on both
+//     sides, wide characters) must leave the terminal holding exactly the
+//     screen's front grid
+//   - seqd_log's scroll region updates must look like a full redraw
+//   - a recording replayed into a fresh terminal must give the same screen
+//   - parameters past SEQD_VT_MAX_PARAMS must be dropped, not run together
+//     with the last one that was kept
+//
+// Build and run from the repository root:
+//     cc -O2 -o vt test/vt.c && ./vt [recording path, /tmp/seqd_vt.rec by default]
+
+#include "../src/seqd.h"
+#include "../src/seqd_screen.h"
+#include "../src/seqd_log.h"
+#include "../src/seqd_vt.h"
+#include "test.h"
+
+#define WIDTH 60
+#define HEIGHT 20
+#define FRAMES 500
+
+static unsigned int random_colour() {
+    switch (next_random() % 3) {
+        case 0:  return SEQD_COLOUR_DEFAULT;
+        case 1:  return SEQD_COLOUR_256(next_random());
+        default: return SEQD_COLOUR_RGB(next_random(), next_random(), next_random());
+    }
+}
+
+static int screen_frames() {
+    static const unsigned int chars[] = { 'a', 'Z', '#', ' ', 0xE9, 0x4E2D, 0x1F600, 0x301 }; // 0x301 is a combining mark, dropped by the screen
+    seqd_screen screen = { 0 };
+    seqd_vt vt;
+
+    seqd_screen_resize(&screen, WIDTH, HEIGHT);
+    seqd_vt_init(&vt, WIDTH, HEIGHT);
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        int changes = frame == 0 ? WIDTH * HEIGHT : (int) (next_random() % 60);
+
+        for (int i = 0; i < changes; i++) {
+            unsigned int ch = chars[next_random() % (sizeof(chars) / sizeof(chars[0]))];
+            unsigned int fg = random_colour();
+            unsigned int bg = random_colour();
+            seqd_screen_put(&screen, next_random() % HEIGHT, next_random() % WIDTH, ch, fg, bg, next_random() & 0xFF);
+        }
+
+        if (next_random() % 10 == 0)
+            seqd_screen_print(&screen, next_random() % HEIGHT, next_random() % WIDTH, "mixed \xe4\xb8\xad\xe6\x96\x87 text", random_colour(), random_colour(), 0);
+
+        seqd_screen_render(&screen);
+        seqd_vt_present(&vt, &seqdctx);
+
+        for (int row = 0; row < HEIGHT; row++) {
+            for (int col = 0; col < WIDTH; col++) {
+                const seqd_cell* want = &screen.front[row * WIDTH + col];
+                const seqd_cell* got = seqd_vt_cell(&vt, row, col);
+
+                if (!seqd_cell_equal(want, got)) {
+                    fprintf(stderr, "screen frame %d, row %d col %d: U+%04X %08X/%08X/%02X, expected U+%04X %08X/%08X/%02X\n",
+                        frame, row, col, got->ch, got->attr.fg, got->attr.bg, got->attr.style, want->ch, want->attr.fg, want->attr.bg, want->attr.style);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    if (vt.unknown != 0) {
+        fprintf(stderr, "screen: %llu sequences weren't understood\n", vt.unknown);
+        return 1;
+    }
+
+    printf("vt: %d screen frames ok, %llu bytes, largest frame %llu\n", FRAMES, vt.bytes, vt.max_frame_bytes);
+    seqd_vt_free(&vt);
+    seqd_screen_free(&screen);
+    return 0;
+}
+
+static int log_frames(const char* path) {
+    seqd_log log;
+    seqd_vt shown, full, replayed;
+    char line[64];
+    int total = 0;
+
+    seqd_log_init(&log, 2, HEIGHT - 4, 200);
+    log.width = WIDTH;
+    seqd_vt_init(&shown, WIDTH, HEIGHT);
+    seqd_vt_init(&full, WIDTH, HEIGHT);
+    seqd_vt_init(&replayed, WIDTH, HEIGHT);
+
+    if (!seqd_vt_record(&shown, path)) {
+        perror(path);
+        return 1;
+    }
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        int lines = (int) (next_random() % 8);
+        for (int i = 0; i < lines; i++) {
+            snprintf(line, sizeof(line), "line %d \xe4\xb8\xad %u", total++, next_random());
+            seqd_log_append(&log, line);
+        }
+
+        if (next_random() % 6 == 0)
+            seqd_log_scroll(&log, (int) (next_random() % 11) - 5);
+        if (next_random() % 9 == 0)
+            seqd_log_follow(&log);
+
+        seqd_log_render(&log);
+        seqd_vt_present(&shown, &seqdctx);
+
+        log.full_redraw = true;                                         // The same view drawn from scratch
+        seqd_log_render(&log);
+        seqd_vt_reset(&full);
+        seqd_vt_present(&full, &seqdctx);
+
+        if (seqd_vt_diff(&shown, &full, 2) != 0) {
+            fprintf(stderr, "log frame %d: scrolled and redrawn panes differ\n", frame);
+            return 1;
+        }
+    }
+
+    seqd_vt_record(&shown, NULL);
+    long long bytes = seqd_vt_replay(&replayed, path);
+
+    if (bytes != (long long) shown.bytes || seqd_vt_diff(&shown, &replayed, 2) != 0) {
+        fprintf(stderr, "log: replaying %lld of %llu bytes gave a different screen\n", bytes, shown.bytes);
+        return 1;
+    }
+
+    printf("vt: %d log frames ok, replayed %lld bytes\n", FRAMES, bytes);
+    remove(path);
+    seqd_vt_free(&shown);
+    seqd_vt_free(&full);
+    seqd_vt_free(&replayed);
+    seqd_log_free(&log);
+    return 0;
+}
+
+static int too_many_params() {
+    char sequence[4 * SEQD_VT_MAX_PARAMS + 16] = "\033[";
+    seqd_vt vt;
+    seqd_vt_init(&vt, WIDTH, HEIGHT);
+
+    // Every parameter that fits is 0 but the last, which turns bold on. The 4 (underline) after it is one too many
+    for (int i = 1; i < SEQD_VT_MAX_PARAMS; i++)
+        strcat(sequence, "0;");
+    strcat(sequence, "1;4mx");
+    seqd_vt_feed(&vt, sequence, strlen(sequence));
+
+    const seqd_cell* cell = seqd_vt_cell(&vt, 0, 0);
+    if (cell->ch != 'x' || cell->attr.style != SEQD_STYLE_BOLD) {
+        fprintf(stderr, "params: U+%04X with style %02X after %d parameters, expected x in bold\n", cell->ch, cell->attr.style, SEQD_VT_MAX_PARAMS + 1);
+        seqd_vt_free(&vt);
+        return 1;
+    }
+
+    // The cursor move after it must still be read from the start
+    seqd_vt_feed(&vt, "\033[5;10H", 8);
+    if (vt.row != 4 || vt.col != 9) {
+        fprintf(stderr, "params: cursor at %d,%d after the long sequence, expected 4,9\n", vt.row, vt.col);
+        seqd_vt_free(&vt);
+        return 1;
+    }
+
+    printf("vt: %d parameters ok\n", SEQD_VT_MAX_PARAMS + 1);
+    seqd_vt_free(&vt);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int failed = screen_frames() || log_frames(argc > 1 ? argv[1] : "/tmp/seqd_vt.rec") || too_many_params();
+    deinit();
+    return failed;
+}
@@ -0,0 +1,122 @@
+// Seqd test - widget dirty tracking
+// Drives a screen of widgets with random changes, many of which don't change
+// anything, and renders after each one into a headless terminal (seqd_vt.h).
+// A box with a label inside is resized now and then, which blanks the label.
+// Every incremental frame must leave the same screen as a full redraw, only
+// the widgets that really changed may be drawn, and a frame with no changes
+// must not queue a single byte.
+//
+// Build and run from the repository root:
+//     cc -O2 -o widget test/widget.c && ./widget
+
+#include "../src/seqd.h"
+#include "../src/seqd_widget.h"
+#include "../src/seqd_vt.h"
+#include "test.h"
+
+#define WIDTH 80
+#define HEIGHT 24
+#define STEPS 5000
+#define LABELS 16
+
+static const char* items[] = { "alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta", "iota", "kappa" };
+static const char* texts[] = { "idle", "running", "done", "failed", "\xe4\xb8\xad\xe6\x96\x87", "" };
+
+int main() {
+    seqd_ui ui;
+    seqd_vt shown, full;
+    seqd_context incremental = { 0 };
+    seqd_context redraw = { 0 };
+    int labels[LABELS];
+
+    seqd_ui_init(&ui);
+    seqd_vt_init(&shown, WIDTH, HEIGHT);
+    seqd_vt_init(&full, WIDTH, HEIGHT);
+
+    seqd_rect area = seqd_rect_make(0, 0, WIDTH, HEIGHT);
+    seqd_ui_box(&ui, area, "widgets");
+    area = seqd_rect_inset(area, 1);
+
+    seqd_rect left = seqd_rect_take_left(&area, 30);
+    int list = seqd_ui_list(&ui, left, items, 10);
+    int bar = seqd_ui_progress(&ui, seqd_rect_take_top(&area, 1), 0.0);
+    for (int i = 0; i < LABELS; i++)
+        labels[i] = seqd_ui_label(&ui, seqd_rect_take_top(&area, 1), texts[0]);
+
+    seqd_rect panel_rect = seqd_rect_make(area.row, area.col, 20, 4);    // Fits in what's left, however it's resized
+    int panel = seqd_ui_box(&ui, panel_rect, "panel");
+    seqd_ui_label(&ui, seqd_rect_inset(panel_rect, 1), "inside\nthe panel");
+
+    ui.ctx = &incremental;
+    seqd_ui_render(&ui);
+    seqd_vt_present(&shown, &incremental);
+
+    for (int step = 0; step < STEPS; step++) {
+        int changes = (int) (next_random() % 4);
+        int changed = 0;                                                // Widgets that will look different, at most one change each below
+
+        for (int i = 0; i < changes; i++) {
+            int label = labels[next_random() % LABELS];
+            const char* text = texts[next_random() % (sizeof(texts) / sizeof(texts[0]))];
+            bool differs = strcmp(seqd_ui_widget(&ui, label)->text, text) != 0 && !seqd_ui_widget(&ui, label)->dirty;
+
+            seqd_ui_set_text(&ui, label, text);
+            changed += differs;
+        }
+
+        int selected = (int) (next_random() % 12) - 1;
+        if (selected >= 10)
+            selected = seqd_ui_widget(&ui, list)->selected;             // The same again, nothing to draw
+        changed += selected != seqd_ui_widget(&ui, list)->selected;
+        seqd_ui_select(&ui, list, selected);
+
+        double value = (next_random() % 8 == 0) ? (next_random() % 100) / 100.0 : -1;
+        if (value >= 0) {
+            int before = seqd_ui_widget(&ui, bar)->filled;
+            seqd_ui_set_progress(&ui, bar, value);
+            changed += seqd_ui_widget(&ui, bar)->filled != before;
+        }
+
+        if (next_random() % 8 == 0) {                                   // The box and the label it blanks
+            seqd_rect resized = seqd_rect_make(area.row, area.col, 20 + (int) (next_random() % (area.width - 19)), 4 + (int) (next_random() % (area.height - 3)));
+            changed += seqd_ui_widget(&ui, panel)->rect.width != resized.width || seqd_ui_widget(&ui, panel)->rect.height != resized.height ? 2 : 0;
+            seqd_ui_move(&ui, panel, resized);
+        }
+
+        int drawn = seqd_ui_render(&ui);
+        if (drawn != changed) {
+            fprintf(stderr, "step %d: drew %d widgets, %d changed\n", step, drawn, changed);
+            return 1;
+        }
+
+        if (drawn == 0 && incremental.size != 0) {
+            fprintf(stderr, "step %d: nothing changed but %zu bytes were queued\n", step, (size_t) incremental.size);
+            return 1;
+        }
+
+        seqd_vt_present(&shown, &incremental);
+
+        // The same state drawn from scratch onto a blank terminal
+        ui.ctx = &redraw;
+        seqd_sgr_invalidate(&redraw);
+        seqd_ui_invalidate_all(&ui);
+        seqd_ui_render(&ui);
+        seqd_vt_reset(&full);
+        seqd_vt_present(&full, &redraw);
+        ui.ctx = &incremental;
+
+        if (seqd_vt_diff(&shown, &full, 2) != 0) {
+            fprintf(stderr, "step %d: incremental frames and a full redraw differ\n", step);
+            return 1;
+        }
+    }
+
+    printf("widget: %d steps ok, %llu bytes incrementally against %llu for full redraws\n", STEPS, shown.bytes, full.bytes);
+
+    seqd_ui_free(&ui);
+    seqd_vt_free(&shown);
+    seqd_vt_free(&full);
+    seqd_context_free(&incremental);
+    seqd_context_free(&redraw);
+    return 0;
+}